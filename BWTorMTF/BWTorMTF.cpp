@@ -2,56 +2,425 @@
 #include <numeric>
 #include <algorithm>
 #include <array>
+#include <bit>
 #include <iostream>
 #include <print>
+#include <future>
+#include "../BitStream/ThreadPool.hpp"
+#include "../BitStream/CpuFeatures.hpp"
+
+namespace {
+    constexpr int32_t SAIS_NAIVE_THRESHOLD = 16;
+    // Скільки разів по N елементів подвоєння може пересортувати, перш ніж поступитися SA-IS.
+    constexpr uint64_t PARALLEL_SORT_WORK_LIMIT = 3;
+
+    // Лінійна побудова суфіксного масиву індукованим сортуванням (SA-IS) для алфавіту [0, upper].
+    template <typename Char>
+    std::vector<int32_t> SaIs(std::span<const Char> s, int32_t upper) {
+        const int32_t n = static_cast<int32_t>(s.size());
+        if (n == 0) return {};
+        if (n < SAIS_NAIVE_THRESHOLD) {
+            std::vector<int32_t> sa(n);
+            std::iota(sa.begin(), sa.end(), 0);
+            std::sort(sa.begin(), sa.end(), [&](int32_t a, int32_t b) {
+                return std::lexicographical_compare(s.begin() + a, s.end(), s.begin() + b, s.end());
+                });
+            return sa;
+        }
+
+        std::vector<int32_t> sa(n);
+        std::vector<bool> ls(n);
+        for (int32_t i = n - 2; i >= 0; --i)
+            ls[i] = (s[i] == s[i + 1]) ? ls[i + 1] : (s[i] < s[i + 1]);
+
+        std::vector<int32_t> sum_l(upper + 1), sum_s(upper + 1);
+        for (int32_t i = 0; i < n; ++i) {
+            if (!ls[i]) sum_s[s[i]]++;
+            else sum_l[s[i] + 1]++;
+        }
+        for (int32_t i = 0; i <= upper; ++i) {
+            sum_s[i] += sum_l[i];
+            if (i < upper) sum_l[i + 1] += sum_s[i];
+        }
+
+        std::vector<int32_t> buf(upper + 1);
+        auto induce = [&](const std::vector<int32_t>& lms) {
+            std::fill(sa.begin(), sa.end(), -1);
+            std::copy(sum_s.begin(), sum_s.end(), buf.begin());
+            for (int32_t d : lms)
+                if (d != n) sa[buf[s[d]]++] = d;
+
+            std::copy(sum_l.begin(), sum_l.end(), buf.begin());
+            sa[buf[s[n - 1]]++] = n - 1;
+            for (int32_t i = 0; i < n; ++i) {
+                const int32_t v = sa[i];
+                if (v >= 1 && !ls[v - 1]) sa[buf[s[v - 1]]++] = v - 1;
+            }
+
+            std::copy(sum_l.begin(), sum_l.end(), buf.begin());
+            for (int32_t i = n - 1; i >= 0; --i) {
+                const int32_t v = sa[i];
+                if (v >= 1 && ls[v - 1]) sa[--buf[s[v - 1] + 1]] = v - 1;
+            }
+            };
+
+        std::vector<int32_t> lms_map(n + 1, -1);
+        std::vector<int32_t> lms;
+        for (int32_t i = 1; i < n; ++i) {
+            if (!ls[i - 1] && ls[i]) {
+                lms_map[i] = static_cast<int32_t>(lms.size());
+                lms.push_back(i);
+            }
+        }
+        const int32_t m = static_cast<int32_t>(lms.size());
+
+        induce(lms);
+        if (m == 0) return sa;
+
+        // Іменуємо LMS-підрядки і рекурсивно сортуємо скорочений рядок.
+        std::vector<int32_t> sorted_lms;
+        sorted_lms.reserve(m);
+        for (int32_t v : sa)
+            if (lms_map[v] != -1) sorted_lms.push_back(v);
+
+        std::vector<int32_t> rec_s(m);
+        int32_t rec_upper = 0;
+        rec_s[lms_map[sorted_lms[0]]] = 0;
+        for (int32_t i = 1; i < m; ++i) {
+            int32_t l = sorted_lms[i - 1], r = sorted_lms[i];
+            const int32_t end_l = (lms_map[l] + 1 < m) ? lms[lms_map[l] + 1] : n;
+            const int32_t end_r = (lms_map[r] + 1 < m) ? lms[lms_map[r] + 1] : n;
+            bool same = true;
+            if (end_l - l != end_r - r) same = false;
+            else {
+                while (l < end_l && s[l] == s[r]) { ++l; ++r; }
+                if (l == n || s[l] != s[r]) same = false;
+            }
+            if (!same) ++rec_upper;
+            rec_s[lms_map[sorted_lms[i]]] = rec_upper;
+        }
+
+        const auto rec_sa = SaIs<int32_t>(rec_s, rec_upper);
+        for (int32_t i = 0; i < m; ++i) sorted_lms[i] = lms[rec_sa[i]];
+        induce(sorted_lms);
+        return sa;
+    }
+
+    struct Group {
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    // Виконує body(begin, end) над [0, count) частинами по одній на потік пулу і чекає завершення.
+    template <typename Body>
+    void ParallelFor(ThreadPool& pool, size_t count, Body&& body) {
+        const size_t step = std::max<size_t>(1, (count + pool.Size() - 1) / pool.Size());
+        std::vector<std::future<void>> jobs;
+        for (size_t b = 0; b < count; b += step)
+            jobs.push_back(pool.Submit([&body, b, e = std::min(count, b + step)] { body(b, e); }));
+        for (auto& job : jobs) job.get();
+    }
+
+    // Сортує діапазон шматками паралельно, далі зливає сусідні шматки попарно.
+    void ParallelSort(ThreadPool& pool, std::span<uint64_t> range) {
+        const size_t parts = pool.Size();
+        const size_t step = (range.size() + parts - 1) / parts;
+        ParallelFor(pool, parts, [&](size_t b, size_t e) {
+            for (size_t p = b; p < e; ++p) {
+                const size_t lo = std::min(range.size(), p * step), hi = std::min(range.size(), lo + step);
+                std::sort(range.begin() + lo, range.begin() + hi);
+            }
+            });
+        for (size_t width = step; width < range.size(); width *= 2) {
+            const size_t merges = (range.size() + 2 * width - 1) / (2 * width);
+            ParallelFor(pool, merges, [&](size_t b, size_t e) {
+                for (size_t m = b; m < e; ++m) {
+                    const size_t lo = m * 2 * width;
+                    const size_t mid = std::min(range.size(), lo + width), hi = std::min(range.size(), lo + 2 * width);
+                    std::inplace_merge(range.begin() + lo, range.begin() + mid, range.begin() + hi);
+                }
+                });
+        }
+    }
+
+    // Паралельне префіксне подвоєння (Ларссон–Садакане) для циклічних зсувів.
+    // Спершу radix-розбиття за першими двома байтами, далі кожен невпорядкований кошик
+    // уточнюється за рангом зсуву на h; кошики незалежні, тож обробляються різними потоками.
+    // На повторюваних даних кошики майже не дрібнішають і кожен раунд знову сортує ~N зсувів;
+    // щойно сумарна робота перевищує PARALLEL_SORT_WORK_LIMIT * N, повертається порожній масив.
+    // Рівні зсуви (періодичний блок) упорядковуються за спаданням позиції, як у SA-IS.
+    std::vector<uint32_t> ParallelRotationSort(std::span<const uint8_t> s, unsigned threads) {
+        const uint32_t N = static_cast<uint32_t>(s.size());
+        constexpr size_t KEYS = 1 << 16;
+        ThreadPool pool(threads);
+        const size_t parts = pool.Size();
+        const size_t step = (size_t(N) + parts - 1) / parts;
+        auto key2 = [&](uint32_t i) { return (uint32_t(s[i]) << 8) | s[i + 1 == N ? 0 : i + 1]; };
+
+        std::vector<uint32_t> sa(N), rank(N);
+        std::vector<std::vector<uint32_t>> hist(parts, std::vector<uint32_t>(KEYS));
+        ParallelFor(pool, parts, [&](size_t b, size_t e) {
+            for (size_t p = b; p < e; ++p)
+                for (size_t i = p * step; i < std::min<size_t>(N, (p + 1) * step); ++i) hist[p][key2(uint32_t(i))]++;
+            });
+
+        std::vector<uint32_t> bucket_start(KEYS);
+        std::vector<Group> groups;
+        uint32_t sum = 0;
+        for (size_t k = 0; k < KEYS; ++k) {
+            bucket_start[k] = sum;
+            for (size_t p = 0; p < parts; ++p) sum += hist[p][k];
+            // Частини заповнюють кошик згори вниз, тож позиції в ньому йдуть спадно.
+            uint32_t top = sum;
+            for (size_t p = 0; p < parts; ++p) {
+                const uint32_t count = hist[p][k];
+                hist[p][k] = top;
+                top -= count;
+            }
+            if (sum - bucket_start[k] > 1) groups.push_back({ bucket_start[k], sum });
+        }
+        ParallelFor(pool, parts, [&](size_t b, size_t e) {
+            for (size_t p = b; p < e; ++p)
+                for (size_t i = p * step; i < std::min<size_t>(N, (p + 1) * step); ++i) {
+                    const uint32_t k = key2(uint32_t(i));
+                    sa[--hist[p][k]] = uint32_t(i);
+                    rank[i] = bucket_start[k];
+                }
+            });
+        hist.clear();
+
+        // tmp[k] = (ранг зсуву на h) << 32 | інвертована позиція; старша половина лишається ключем
+        // для поділу кошика, молодша впорядковує рівні зсуви за спаданням позиції.
+        std::vector<uint64_t> tmp(N);
+        const size_t big_group = std::max<size_t>(size_t(N) / (2 * parts), 1);
+        uint64_t work = 0;
+
+        for (uint64_t h = 2; !groups.empty() && h < N; h *= 2) {
+            for (const auto& g : groups) work += g.end - g.begin;
+            if (work > PARALLEL_SORT_WORK_LIMIT * N) return {};
+
+            auto fill = [&](const Group& g) {
+                for (uint32_t k = g.begin; k < g.end; ++k) {
+                    const uint32_t next = static_cast<uint32_t>((sa[k] + h) % N);
+                    tmp[k] = (uint64_t(rank[next]) << 32) | uint32_t(~sa[k]);
+                }
+            };
+            auto unpack = [&](const Group& g) {
+                for (uint32_t k = g.begin; k < g.end; ++k) sa[k] = ~static_cast<uint32_t>(tmp[k]);
+            };
+
+            // Великі кошики сортуються всім пулом, дрібні розподіляються між потоками цілими.
+            std::vector<Group> small;
+            for (const auto& g : groups) {
+                if (g.end - g.begin < big_group) { small.push_back(g); continue; }
+                ParallelFor(pool, g.end - g.begin, [&](size_t b, size_t e) {
+                    fill({ g.begin + uint32_t(b), g.begin + uint32_t(e) });
+                    });
+                // На довгих повторах кошик часто вже впорядкований — тоді сортування не потрібне.
+                if (std::is_sorted(tmp.begin() + g.begin, tmp.begin() + g.end)) continue;
+                ParallelSort(pool, std::span<uint64_t>(tmp).subspan(g.begin, g.end - g.begin));
+                ParallelFor(pool, g.end - g.begin, [&](size_t b, size_t e) {
+                    unpack({ g.begin + uint32_t(b), g.begin + uint32_t(e) });
+                    });
+            }
+            ParallelFor(pool, small.size(), [&](size_t b, size_t e) {
+                for (size_t i = b; i < e; ++i) {
+                    fill(small[i]);
+                    if (std::is_sorted(tmp.begin() + small[i].begin, tmp.begin() + small[i].end)) continue;
+                    std::sort(tmp.begin() + small[i].begin, tmp.begin() + small[i].end);
+                    unpack(small[i]);
+                }
+                });
+
+            // Ранги оновлюються лише після того, як усі кошики цього раунду прочитали старі.
+            std::vector<std::vector<Group>> next_groups(parts);
+            std::vector<std::future<void>> jobs;
+            const size_t group_step = (groups.size() + parts - 1) / parts;
+            for (size_t p = 0; p * group_step < groups.size(); ++p) {
+                jobs.push_back(pool.Submit([&, p] {
+                    const size_t end = std::min(groups.size(), (p + 1) * group_step);
+                    for (size_t i = p * group_step; i < end; ++i) {
+                        const Group g = groups[i];
+                        uint32_t start = g.begin;
+                        for (uint32_t k = g.begin; k < g.end; ++k) {
+                            if (k > g.begin && (tmp[k] >> 32) != (tmp[k - 1] >> 32)) {
+                                if (k - start > 1) next_groups[p].push_back({ start, k });
+                                start = k;
+                            }
+                            rank[sa[k]] = start;
+                        }
+                        if (g.end - start > 1) next_groups[p].push_back({ start, g.end });
+                    }
+                }));
+            }
+            for (auto& job : jobs) job.get();
+
+            groups.clear();
+            for (auto& part : next_groups) groups.insert(groups.end(), part.begin(), part.end());
+        }
+        return sa;
+    }
+
+    // Fused: елемент зберігає наступний рядок разом із символом, (next << 8) | symbol, тож крок
+    // зворотного BWT — один довільний доступ; для блоків від 16 МіБ next не вміщається в 24 біти
+    // і символ читається з input. Ланцюжки k починаються з позицій k * N / S і йдуть почергово,
+    // щоб промахи кешу різних ланцюжків перекривалися.
+    template <bool Fused>
+    void InverseBwt(std::span<const uint8_t> input, std::span<const uint32_t> rows, std::span<uint8_t> decoded) {
+        const uint32_t N = static_cast<uint32_t>(input.size());
+        std::array<uint32_t, 256> starts{};
+        for (uint8_t c : input) starts[c]++;
+        uint32_t sum = 0;
+        for (auto& start : starts) {
+            const uint32_t count = start;
+            start = sum;
+            sum += count;
+        }
+
+        std::vector<uint32_t> links(N);
+        for (uint32_t i = 0; i < N; ++i)
+            links[starts[input[i]]++] = Fused ? (i << 8) | input[i] : i;
+
+        auto step = [&](uint32_t& curr) -> uint8_t {
+            if constexpr (Fused) {
+                const uint32_t e = links[curr];
+                curr = e >> 8;
+                return static_cast<uint8_t>(e);
+            }
+            else {
+                curr = links[curr];
+                return input[curr];
+            }
+        };
+
+        const size_t S = rows.size();
+        std::vector<uint32_t> curr(rows.begin(), rows.end()), pos(S), end(S);
+        uint32_t common = N;
+        for (size_t k = 0; k < S; ++k) {
+            pos[k] = static_cast<uint32_t>(uint64_t(k) * N / S);
+            end[k] = static_cast<uint32_t>(uint64_t(k + 1) * N / S);
+            common = std::min(common, end[k] - pos[k]);
+        }
+
+        for (uint32_t t = 0; t < common; ++t)
+            for (size_t k = 0; k < S; ++k) decoded[pos[k]++] = step(curr[k]);
+        for (size_t k = 0; k < S; ++k)
+            while (pos[k] < end[k]) decoded[pos[k]++] = step(curr[k]);
+    }
+
+    // Рівень вейвлет-матриці: 256 бітів разом із кількістю одиниць перед блоком і перед кожним словом
+    // у ньому, щоб ранг рахувався одним popcount; 40 байтів на 256 символів.
+    struct RankBlock {
+        uint32_t rank = 0;
+        std::array<uint8_t, 4> word_rank{};
+        std::array<uint64_t, 4> bits{};
+    };
+
+    // Вейвлет-матриця над байтами: 8 бітових рівнів від старшого біта, 1.25 байта на символ.
+    class WaveletMatrix {
+    public:
+        explicit WaveletMatrix(std::span<const uint8_t> data) {
+            std::array<uint32_t, 256> counts{};
+            for (uint8_t c : data) counts[c]++;
+
+            // На рівні level символи стабільно впорядковані за вже пройденими бітами, останній — найстарший,
+            // тож позицію кожного можна поставити підрахунком, без проміжної копії послідовності.
+            std::array<uint8_t, 256> key{};
+            for (int level = 0; level < 8; ++level) {
+                auto& blocks = levels_[level];
+                blocks.assign(data.size() / 256 + 1, RankBlock{});
+
+                std::array<uint32_t, 256> next{};
+                for (int c = 0; c < 256; ++c) next[key[c]] += counts[c];
+                uint32_t sum = 0;
+                for (auto& n : next) {
+                    const uint32_t count = n;
+                    n = sum;
+                    sum += count;
+                }
+                for (uint8_t c : data) {
+                    const uint32_t pos = next[key[c]]++;
+                    if ((c >> (7 - level)) & 1) blocks[pos / 256].bits[(pos / 64) % 4] |= uint64_t(1) << (pos % 64);
+                }
+
+                uint32_t ones = 0;
+                for (auto& block : blocks) {
+                    block.rank = ones;
+                    for (size_t w = 0; w < block.bits.size(); ++w) {
+                        block.word_rank[w] = static_cast<uint8_t>(ones - block.rank);
+                        ones += std::popcount(block.bits[w]);
+                    }
+                }
+                zeros_[level] = static_cast<uint32_t>(data.size()) - ones;
+                for (int c = 0; c < 256; ++c) key[c] |= ((c >> (7 - level)) & 1) << level;
+            }
+
+            std::array<int, 256> by_key{};
+            for (int c = 0; c < 256; ++c) by_key[key[c]] = c;
+            uint32_t sum = 0;
+            for (int c : by_key) {
+                start_[c] = sum;
+                sum += counts[c];
+            }
+        }
+
+        // Один рівень спуску: дописує до c біт символу в позиції i і повертає її позицію на наступному рівні.
+        uint32_t Descend(int level, uint32_t i, uint32_t& c) const {
+            const RankBlock& block = levels_[level][i / 256];
+            const unsigned word = (i / 64) % 4, offset = i % 64;
+            const uint32_t ones = block.rank + block.word_rank[word] +
+                std::popcount(block.bits[word] & ((uint64_t(1) << offset) - 1));
+            const unsigned bit = (block.bits[word] >> offset) & 1;
+            c = (c << 1) | bit;
+            return bit ? zeros_[level] + ones : i - ones;
+        }
+
+        // Після восьми рівнів позиція символу c мінус початок його ділянки — кількість таких самих символів перед ним.
+        uint32_t Rank(uint32_t i, uint32_t c) const { return i - start_[c]; }
+
+    private:
+        std::array<std::vector<RankBlock>, 8> levels_;
+        std::array<uint32_t, 8> zeros_{};
+        std::array<uint32_t, 256> start_{};
+    };
+}
 
 std::string_view TransformError_to_string(TransformError err) {
     switch (err) {
     case TransformError::EmptyInput:   return "Порожній вхідний блок для перетворення.";
     case TransformError::InvalidIndex: return "Некоректний index для зворотного BWT.";
+    case TransformError::InvalidRunLength: return "Пошкоджена серія нулів RUNA/RUNB.";
     default:                           return "Невідома помилка перетворення.";
     }
 }
 
-std::expected<std::vector<uint8_t>, TransformError> BWT::Encode(std::span<const uint8_t> input, uint32_t& out_primary_index) {
+std::expected<std::vector<uint8_t>, TransformError> BWT::Encode(std::span<const uint8_t> input, uint32_t& out_primary_index,
+    unsigned threads, std::span<uint32_t> chain_starts)
+{
     if (input.empty()) {
         std::println(stderr, "BWT Encode Error: {}", TransformError_to_string(TransformError::EmptyInput));
         return std::unexpected(TransformError::EmptyInput);
     }
     if (input.size() == 1) {
         out_primary_index = 0;
+        std::fill(chain_starts.begin(), chain_starts.end(), 0u);
         return std::vector<uint8_t>{input[0]};
     }
 
     const uint32_t N = static_cast<uint32_t>(input.size());
 
-    std::vector<uint32_t> sa(N), rank(N), temp_rank(N);
-    for (uint32_t i = 0; i < N; ++i) {
-        sa[i] = i;
-        rank[i] = input[i];
-    }
-
-    for (uint32_t k = 1; k < N; k *= 2) {
-        auto cmp_sort = [&](uint32_t a, uint32_t b) {
-            if (rank[a] != rank[b]) return rank[a] < rank[b];
-            uint32_t rx = rank[(a + k) % N];
-            uint32_t ry = rank[(b + k) % N];
-            if (rx != ry) return rx < ry;
-            return a < b; 
-            };
-        std::sort(sa.begin(), sa.end(), cmp_sort);
-
-        auto equal_rank = [&](uint32_t a, uint32_t b) {
-            return rank[a] == rank[b] && rank[(a + k) % N] == rank[(b + k) % N];
-            };
-
-        temp_rank[sa[0]] = 0;
-        for (uint32_t i = 1; i < N; ++i) {
-            temp_rank[sa[i]] = temp_rank[sa[i - 1]] + (equal_rank(sa[i - 1], sa[i]) ? 0 : 1);
-        }
-        rank = temp_rank;
+    std::vector<uint32_t> sa;
+    if (threads > 1 && N >= PARALLEL_SORT_THRESHOLD) sa = ParallelRotationSort(input, threads);
+    if (sa.empty()) {
+        // Циклічні зсуви s упорядковані так само, як суфікси ss, що починаються в першій половині.
+        std::vector<uint8_t> doubled(2 * size_t(N));
+        std::copy(input.begin(), input.end(), doubled.begin());
+        std::copy(input.begin(), input.end(), doubled.begin() + N);
+        const auto full_sa = SaIs<uint8_t>(doubled, 255);
 
-        if (rank[sa.back()] == N - 1) break;
+        sa.reserve(N);
+        for (int32_t p : full_sa)
+            if (static_cast<uint32_t>(p) < N) sa.push_back(static_cast<uint32_t>(p));
     }
 
     std::vector<uint8_t> L(N);
@@ -64,62 +433,243 @@ std::expected<std::vector<uint8_t>, TransformError> BWT::Encode(std::span<const
             L[i] = input[sa[i] - 1];
         }
     }
+
+    // Зворотний BWT видає позицію p, стартуючи з рядка, де sa[row] == p.
+    if (!chain_starts.empty()) {
+        const size_t S = chain_starts.size() + 1;
+        std::vector<uint32_t> targets(S - 1);
+        for (size_t k = 1; k < S; ++k) targets[k - 1] = static_cast<uint32_t>(uint64_t(k) * N / S);
+        for (uint32_t i = 0; i < N; ++i)
+            for (size_t k = 0; k < targets.size(); ++k)
+                if (sa[i] == targets[k]) chain_starts[k] = i;
+    }
     return L;
 }
 
-std::expected<std::vector<uint8_t>, TransformError> BWT::Decode(std::span<const uint8_t> input, uint32_t primary_index) {
+std::expected<std::vector<uint8_t>, TransformError> BWT::Decode(std::span<const uint8_t> input, uint32_t primary_index,
+    std::span<const uint32_t> chain_starts)
+{
     if (input.empty()) {
 		std::println(stderr, "BWT Decode Error: {}", TransformError_to_string(TransformError::EmptyInput));
         return std::unexpected(TransformError::EmptyInput);
     }
     const uint32_t N = static_cast<uint32_t>(input.size());
-    if (primary_index >= N) {
+    if (primary_index >= N || std::ranges::any_of(chain_starts, [N](uint32_t row) { return row >= N; })) {
 		std::println(stderr, "BWT Decode Error: {}", TransformError_to_string(TransformError::InvalidIndex));
         return std::unexpected(TransformError::InvalidIndex);
     }
 
-    std::vector<uint32_t> counts(256, 0);
-    for (uint8_t c : input) counts[c]++;
+    std::vector<uint32_t> rows(chain_starts.size() + 1);
+    rows[0] = primary_index;
+    std::copy(chain_starts.begin(), chain_starts.end(), rows.begin() + 1);
+
+    std::vector<uint8_t> decoded(N);
+    if (N < (1u << 24)) InverseBwt<true>(input, rows, decoded);
+    else InverseBwt<false>(input, rows, decoded);
+    return decoded;
+}
 
-    std::vector<uint32_t> starts(256, 0);
+std::expected<std::vector<uint8_t>, TransformError> BWT::DecodeLowMemory(std::span<const uint8_t> input, uint32_t primary_index,
+    std::span<const uint32_t> chain_starts)
+{
+    if (input.empty()) {
+		std::println(stderr, "BWT Decode Error: {}", TransformError_to_string(TransformError::EmptyInput));
+        return std::unexpected(TransformError::EmptyInput);
+    }
+    const uint32_t N = static_cast<uint32_t>(input.size());
+    if (primary_index >= N || std::ranges::any_of(chain_starts, [N](uint32_t row) { return row >= N; })) {
+		std::println(stderr, "BWT Decode Error: {}", TransformError_to_string(TransformError::InvalidIndex));
+        return std::unexpected(TransformError::InvalidIndex);
+    }
+
+    const WaveletMatrix wm(input);
+    std::array<uint32_t, 256> first{};
+    for (uint8_t c : input) first[c]++;
     uint32_t sum = 0;
-    for (int i = 0; i < 256; ++i) {
-        starts[i] = sum;
-        sum += counts[i];
+    for (auto& f : first) {
+        const uint32_t count = f;
+        f = sum;
+        sum += count;
     }
 
-    std::vector<uint32_t> T(N);
-    for (uint32_t i = 0; i < N; ++i) {
-        T[starts[input[i]]++] = i;
+    // LF іде назад: з рядка позиції p видає s[p - 1], s[p - 2], ... Ланцюжок k заповнює [p_k, p_{k+1})
+    // від рядка позиції p_{k+1}; останній стартує з primary_index, тобто з позиції N.
+    const size_t S = chain_starts.size() + 1;
+    std::vector<uint32_t> curr(S), pos(S), begin(S);
+    uint32_t common = N;
+    for (size_t k = 0; k < S; ++k) {
+        begin[k] = static_cast<uint32_t>(uint64_t(k) * N / S);
+        pos[k] = static_cast<uint32_t>(uint64_t(k + 1) * N / S);
+        curr[k] = k + 1 < S ? chain_starts[k] : primary_index;
+        common = std::min(common, pos[k] - begin[k]);
     }
 
+    // Рівні спуску чергуються між ланцюжками, щоб промахи кешу незалежних ланцюжків перекривалися.
     std::vector<uint8_t> decoded(N);
-    uint32_t curr = primary_index;
-    for (uint32_t i = 0; i < N; ++i) {
-        curr = T[curr];
-        decoded[i] = input[curr];
-    }
+    std::vector<uint32_t> row(S), sym(S);
+    auto advance = [&](size_t from, size_t to) {
+        for (size_t k = from; k < to; ++k) {
+            row[k] = curr[k];
+            sym[k] = 0;
+        }
+        for (int level = 0; level < 8; ++level)
+            for (size_t k = from; k < to; ++k) row[k] = wm.Descend(level, row[k], sym[k]);
+        for (size_t k = from; k < to; ++k) {
+            decoded[--pos[k]] = static_cast<uint8_t>(sym[k]);
+            curr[k] = first[sym[k]] + wm.Rank(row[k], sym[k]);
+        }
+    };
+    for (uint32_t t = 0; t < common; ++t) advance(0, S);
+    for (size_t k = 0; k < S; ++k)
+        while (pos[k] > begin[k]) advance(k, k + 1);
     return decoded;
 }
 
+namespace {
+    // Вирівняний алфавіт MTF, щоб векторні ядра працювали цілими регістрами без хвостів.
+    struct alignas(32) MtfAlphabet {
+        std::array<uint8_t, 256> symbols;
+
+        MtfAlphabet() { std::iota(symbols.begin(), symbols.end(), 0); }
+    };
+
+    template <bool Encode>
+    void MtfScalar(std::span<const uint8_t> input, std::span<uint8_t> output) {
+        MtfAlphabet alphabet;
+        uint8_t* a = alphabet.symbols.data();
+        for (size_t i = 0; i < input.size(); ++i) {
+            uint8_t pos = 0, c = input[i];
+            if constexpr (Encode) {
+                while (a[pos] != c) pos++;
+                output[i] = pos;
+            }
+            else {
+                pos = c;
+                c = a[pos];
+                output[i] = c;
+            }
+            for (uint8_t j = pos; j > 0; --j) a[j] = a[j - 1];
+            a[0] = c;
+        }
+    }
+
+#ifdef BITSTREAM_X86_64
+    // SSE2 входить до базового x86-64, тож це запасний векторний шлях без перевірки процесора.
+    inline unsigned MtfFindSSE2(const uint8_t* a, uint8_t c) {
+        const __m128i needle = _mm_set1_epi8(static_cast<char>(c));
+        for (unsigned base = 0;; base += 16) {
+            const __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(a + base));
+            if (const unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, needle)))
+                return base + std::countr_zero(mask);
+        }
+    }
+
+    // Зсуває a[0..pos) на байт угору вирівняними регістрами знизу вгору, переносячи старший байт у наступний,
+    // і ставить c на нульову позицію; байти вище pos в останньому регістрі лишаються як були.
+    inline void MtfMoveSSE2(uint8_t* a, unsigned pos, uint8_t c) {
+        __m128i carry = _mm_cvtsi32_si128(c);
+        const unsigned last = pos / 16;
+        for (unsigned k = 0; k < last; ++k) {
+            const __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(a + 16 * k));
+            _mm_store_si128(reinterpret_cast<__m128i*>(a + 16 * k), _mm_or_si128(_mm_slli_si128(v, 1), carry));
+            carry = _mm_srli_si128(v, 15);
+        }
+        const __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(a + 16 * last));
+        const __m128i shifted = _mm_or_si128(_mm_slli_si128(v, 1), carry);
+        const __m128i index = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        const __m128i keep = _mm_cmpgt_epi8(index, _mm_set1_epi8(static_cast<char>(pos % 16)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(a + 16 * last), _mm_or_si128(_mm_and_si128(keep, v), _mm_andnot_si128(keep, shifted)));
+    }
+
+    template <bool Encode>
+    void MtfSSE2(std::span<const uint8_t> input, std::span<uint8_t> output) {
+        MtfAlphabet alphabet;
+        uint8_t* a = alphabet.symbols.data();
+        for (size_t i = 0; i < input.size(); ++i) {
+            uint8_t c = input[i];
+            unsigned pos;
+            if constexpr (Encode) {
+                pos = a[0] == c ? 0 : MtfFindSSE2(a, c);
+                output[i] = static_cast<uint8_t>(pos);
+            }
+            else {
+                pos = c;
+                c = a[pos];
+                output[i] = c;
+            }
+            MtfMoveSSE2(a, pos, c);
+        }
+    }
+
+    BITSTREAM_TARGET_AVX2
+    inline unsigned MtfFindAVX2(const uint8_t* a, uint8_t c) {
+        const __m256i needle = _mm256_set1_epi8(static_cast<char>(c));
+        for (unsigned base = 0;; base += 32) {
+            const __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(a + base));
+            if (const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle))))
+                return base + std::countr_zero(mask);
+        }
+    }
+
+    // Те саме, що MtfMoveSSE2; зсув на байт через межу 128-бітних половин — permute2x128 + alignr.
+    BITSTREAM_TARGET_AVX2
+    inline void MtfMoveAVX2(uint8_t* a, unsigned pos, uint8_t c) {
+        __m256i carry = _mm256_zextsi128_si256(_mm_cvtsi32_si128(c));
+        const unsigned last = pos / 32;
+        for (unsigned k = 0; k < last; ++k) {
+            const __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(a + 32 * k));
+            const __m256i shifted = _mm256_alignr_epi8(v, _mm256_permute2x128_si256(v, v, 0x08), 15);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(a + 32 * k), _mm256_or_si256(shifted, carry));
+            carry = _mm256_srli_si256(_mm256_permute2x128_si256(v, v, 0x81), 15);
+        }
+        const __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(a + 32 * last));
+        const __m256i shifted = _mm256_or_si256(_mm256_alignr_epi8(v, _mm256_permute2x128_si256(v, v, 0x08), 15), carry);
+        const __m256i index = _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+            16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31);
+        const __m256i keep = _mm256_cmpgt_epi8(index, _mm256_set1_epi8(static_cast<char>(pos % 32)));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(a + 32 * last), _mm256_blendv_epi8(shifted, v, keep));
+    }
+
+    template <bool Encode>
+    BITSTREAM_TARGET_AVX2
+    void MtfAVX2(std::span<const uint8_t> input, std::span<uint8_t> output) {
+        MtfAlphabet alphabet;
+        uint8_t* a = alphabet.symbols.data();
+        for (size_t i = 0; i < input.size(); ++i) {
+            uint8_t c = input[i];
+            unsigned pos;
+            if constexpr (Encode) {
+                pos = a[0] == c ? 0 : MtfFindAVX2(a, c);
+                output[i] = static_cast<uint8_t>(pos);
+            }
+            else {
+                pos = c;
+                c = a[pos];
+                output[i] = c;
+            }
+            MtfMoveAVX2(a, pos, c);
+        }
+    }
+#endif
+
+    template <bool Encode>
+    void RunMtf(std::span<const uint8_t> input, std::span<uint8_t> output) {
+#ifdef BITSTREAM_X86_64
+        if (CpuFeatures::HasAVX2()) MtfAVX2<Encode>(input, output);
+        else MtfSSE2<Encode>(input, output);
+#else
+        MtfScalar<Encode>(input, output);
+#endif
+    }
+}
+
 std::expected<std::vector<uint8_t>, TransformError> MTF::Encode(std::span<const uint8_t> input) {
     if (input.empty()) {
 		std::println(stderr, "MTF Encode Error: {}", TransformError_to_string(TransformError::EmptyInput));
         return std::unexpected(TransformError::EmptyInput);
     }
     std::vector<uint8_t> output(input.size());
-    std::array<uint8_t, 256> alphabet;
-    std::iota(alphabet.begin(), alphabet.end(), 0);
-
-    for (size_t i = 0; i < input.size(); ++i) {
-        uint8_t c = input[i];
-        uint8_t pos = 0;
-        while (alphabet[pos] != c) pos++;
-
-        output[i] = pos;
-        for (uint8_t j = pos; j > 0; --j) alphabet[j] = alphabet[j - 1];
-        alphabet[0] = c;
-    }
+    RunMtf<true>(input, output);
     return output;
 }
 
@@ -129,16 +679,67 @@ std::expected<std::vector<uint8_t>, TransformError> MTF::Decode(std::span<const
         return std::unexpected(TransformError::EmptyInput);
     }
     std::vector<uint8_t> output(input.size());
-    std::array<uint8_t, 256> alphabet;
-    std::iota(alphabet.begin(), alphabet.end(), 0);
+    RunMtf<false>(input, output);
+    return output;
+}
+
+std::expected<std::vector<uint8_t>, TransformError> ZeroRun::Encode(std::span<const uint8_t> input) {
+    if (input.empty()) {
+		std::println(stderr, "ZeroRun Encode Error: {}", TransformError_to_string(TransformError::EmptyInput));
+        return std::unexpected(TransformError::EmptyInput);
+    }
+    std::vector<uint8_t> output;
+    output.reserve(input.size());
 
-    for (size_t i = 0; i < input.size(); ++i) {
-        uint8_t pos = input[i];
-        uint8_t c = alphabet[pos];
+    for (size_t i = 0; i < input.size();) {
+        if (input[i] == 0) {
+            const size_t end = std::find_if(input.begin() + i, input.end(), [](uint8_t v) { return v != 0; }) - input.begin();
+            for (size_t run = end - i; run > 0; run = (run - 1) / 2)
+                output.push_back(run & 1 ? RUNA : RUNB);
+            i = end;
+            continue;
+        }
+        const uint8_t v = input[i++];
+        if (v < ESCAPE - 1) output.push_back(v + 1);
+        else {
+            output.push_back(ESCAPE);
+            output.push_back(v - (ESCAPE - 1));
+        }
+    }
+    return output;
+}
 
-        output[i] = c;
-        for (uint8_t j = pos; j > 0; --j) alphabet[j] = alphabet[j - 1];
-        alphabet[0] = c;
+std::expected<std::vector<uint8_t>, TransformError> ZeroRun::Decode(std::span<const uint8_t> input, size_t max_size) {
+    if (input.empty()) {
+		std::println(stderr, "ZeroRun Decode Error: {}", TransformError_to_string(TransformError::EmptyInput));
+        return std::unexpected(TransformError::EmptyInput);
+    }
+    auto fail = []() -> std::expected<std::vector<uint8_t>, TransformError> {
+		std::println(stderr, "ZeroRun Decode Error: {}", TransformError_to_string(TransformError::InvalidRunLength));
+        return std::unexpected(TransformError::InvalidRunLength);
+    };
+
+    std::vector<uint8_t> output;
+    output.reserve(std::min(max_size, input.size() * 4));
+
+    for (size_t i = 0; i < input.size();) {
+        if (input[i] <= RUNB) {
+            // Цифри серії йдуть підряд; перевірка на кожній цифрі не дає вазі переповнитися.
+            size_t run = 0;
+            for (size_t weight = 1; i < input.size() && input[i] <= RUNB; ++i, weight <<= 1) {
+                run += weight << input[i];
+                if (run > max_size - output.size()) return fail();
+            }
+            output.insert(output.end(), run, 0);
+            continue;
+        }
+        uint8_t v = input[i++] - 1;
+        if (v == ESCAPE - 1) {
+            if (i == input.size() || input[i] > 1) return fail();
+            v = static_cast<uint8_t>(ESCAPE - 1 + input[i++]);
+        }
+        if (output.size() == max_size) return fail();
+        output.push_back(v);
     }
     return output;
-}
\ No newline at end of file
+}
@@ -8,15 +8,28 @@
 
 enum class TransformError {
     EmptyInput,
-    InvalidIndex
+    InvalidIndex,
+    InvalidRunLength
 };
 
 std::string_view TransformError_to_string(TransformError err);
 
 class BWT {
 public:
-    static std::expected<std::vector<uint8_t>, TransformError> Encode(std::span<const uint8_t> input, uint32_t& out_primary_index);
-    static std::expected<std::vector<uint8_t>, TransformError> Decode(std::span<const uint8_t> input, uint32_t primary_index);
+    // Від PARALLEL_SORT_THRESHOLD байтів і threads > 1 зсуви сортуються паралельно, інакше — SA-IS.
+    // На повторюваних блоках паралельне сортування поступається SA-IS; результат від threads не залежить.
+    static constexpr uint32_t PARALLEL_SORT_THRESHOLD = 4u * 1024 * 1024;
+
+    // chain_starts (S - 1 елементів) отримує рядки, з яких зворотний BWT починає позиції k * N / S, k = 1..S-1.
+    static std::expected<std::vector<uint8_t>, TransformError> Encode(std::span<const uint8_t> input, uint32_t& out_primary_index,
+        unsigned threads = 1, std::span<uint32_t> chain_starts = {});
+    // З chain_starts відновлення йде S незалежними ланцюжками одночасно.
+    static std::expected<std::vector<uint8_t>, TransformError> Decode(std::span<const uint8_t> input, uint32_t primary_index,
+        std::span<const uint32_t> chain_starts = {});
+    // Той самий результат, що й Decode, але замість масиву переходів (4 байти на символ) — LF-відображення
+    // через вейвлет-матрицю з ранговими контрольними точками (1.25 байта на символ), ціною кількох промахів кешу на крок.
+    static std::expected<std::vector<uint8_t>, TransformError> DecodeLowMemory(std::span<const uint8_t> input, uint32_t primary_index,
+        std::span<const uint32_t> chain_starts = {});
 };
 
 class MTF {
@@ -24,4 +37,19 @@ public:
 
     static std::expected<std::vector<uint8_t>, TransformError> Encode(std::span<const uint8_t> input);
     static std::expected<std::vector<uint8_t>, TransformError> Decode(std::span<const uint8_t> input);
+};
+
+// Серії нулів після MTF у стилі bzip2: довжина серії записується біективною двійковою системою
+// цифрами RUNA (1) і RUNB (2), молодшою першою. Решта значень зсувається на 1; 254 і 255 не вміщаються
+// в байт і йдуть як ESCAPE та ще один байт (значення - 254).
+class ZeroRun {
+public:
+    static constexpr uint8_t RUNA = 0;
+    static constexpr uint8_t RUNB = 1;
+    static constexpr uint8_t ESCAPE = 255;
+
+    // Результат може бути до двох разів довшим за вхід, якщо той складається зі значень 254 і 255.
+    static std::expected<std::vector<uint8_t>, TransformError> Encode(std::span<const uint8_t> input);
+    // max_size обмежує розмір результату, щоб пошкоджена серія не розгорнулася в гігабайти.
+    static std::expected<std::vector<uint8_t>, TransformError> Decode(std::span<const uint8_t> input, size_t max_size);
 };
\ No newline at end of file
@@ -1,7 +1,11 @@
 #include "BWTorMTFSplitting.hpp"
 #include "BWTorMTF.hpp"
+#include "../BitStream/ThreadPool.hpp"
 #include <fstream>
 #include <vector>
+#include <deque>
+#include <future>
+#include <algorithm>
 #include <iostream>
 #include <print>
 
@@ -9,14 +13,96 @@ std::string_view SplittingError_to_string(SplittingError err) {
     switch (err) {
 	case SplittingError::FileOpenError:   return "Помилка відкриття файлу для читання або запису.";
 	case SplittingError::TransformFailed: return "Помилка при застосуванні перетворень BWT/MTF.";
+	case SplittingError::InvalidBlockSize: return "Некоректний розмір блоку BWT. Допустимо від 1 КіБ до 256 МіБ.";
+	case SplittingError::MemoryBudgetExceeded: return "Блок BWT не вміщається в заданий бюджет пам'яті.";
+	case SplittingError::InvalidFormat:   return "Пошкоджений потік перетворень BWT/MTF.";
+	case SplittingError::InvalidChainCount: return "Некоректна кількість ланцюжків BWT. Допустимо від 1 до 8.";
 	default:                              return "Сталася невідома помилка при роботі з перетвореннями BWT/MTF.";
     }
 }
 
+unsigned TransformSplitting::WorkerLimit(uint32_t block_size, size_t memory_budget, size_t bytes_per_symbol, unsigned threads) {
+    if (memory_budget == 0) memory_budget = DEFAULT_MEMORY_BUDGET;
+    if (threads == 0) threads = ThreadPool::DefaultThreads();
+    const uint64_t per_worker = uint64_t(block_size) * (bytes_per_symbol + QUEUED_BYTES_PER_SYMBOL);
+    return static_cast<unsigned>(std::min<uint64_t>(threads, memory_budget / per_worker));
+}
+
+std::expected<void, SplittingError> TransformSplitting::ValidateBlockSize(uint32_t block_size, size_t memory_budget) {
+    if (block_size == 0) block_size = DEFAULT_BLOCK_SIZE;
+    if (block_size < MIN_BLOCK_SIZE || block_size > MAX_BLOCK_SIZE)
+        return std::unexpected(SplittingError::InvalidBlockSize);
+    if (WorkerLimit(block_size, memory_budget, ENCODE_BYTES_PER_SYMBOL, 1) == 0)
+        return std::unexpected(SplittingError::MemoryBudgetExceeded);
+    return {};
+}
+
+std::expected<TransformSplitting::Block, SplittingError> TransformSplitting::ForwardBlock(
+    std::span<const uint8_t> input, bool use_bwt, bool use_mtf, bool use_zero_runs, unsigned sort_threads, uint8_t bwt_chains)
+{
+    Block block;
+    std::span<const uint8_t> current_span = input;
+
+    if (use_bwt) {
+        block.chain_starts.resize(bwt_chains - 1);
+        auto bwt_res = BWT::Encode(current_span, block.bwt_index, sort_threads, block.chain_starts);
+        if (!bwt_res) return std::unexpected(SplittingError::TransformFailed);
+        block.data = std::move(bwt_res.value());
+        current_span = block.data;
+    }
+    if (use_mtf) {
+        auto mtf_res = MTF::Encode(current_span);
+        if (!mtf_res) return std::unexpected(SplittingError::TransformFailed);
+        block.data = std::move(mtf_res.value());
+        current_span = block.data;
+    }
+    if (use_zero_runs) {
+        auto runs_res = ZeroRun::Encode(current_span);
+        if (!runs_res) return std::unexpected(SplittingError::TransformFailed);
+        block.data = std::move(runs_res.value());
+    }
+    if (!use_bwt && !use_mtf && !use_zero_runs) block.data.assign(input.begin(), input.end());
+    return block;
+}
+
+std::expected<TransformSplitting::Block, SplittingError> TransformSplitting::ReverseBlock(
+    Block block, bool use_bwt, bool use_mtf, bool use_zero_runs, uint32_t block_size, bool low_memory)
+{
+    if (use_zero_runs) {
+        auto runs_res = ZeroRun::Decode(block.data, block_size);
+        if (!runs_res) return std::unexpected(SplittingError::TransformFailed);
+        block.data = std::move(runs_res.value());
+    }
+    if (use_mtf) {
+        auto mtf_res = MTF::Decode(block.data);
+        if (!mtf_res) return std::unexpected(SplittingError::TransformFailed);
+        block.data = std::move(mtf_res.value());
+    }
+    if (use_bwt) {
+        auto bwt_res = low_memory ? BWT::DecodeLowMemory(block.data, block.bwt_index, block.chain_starts)
+                                  : BWT::Decode(block.data, block.bwt_index, block.chain_starts);
+        if (!bwt_res) return std::unexpected(SplittingError::TransformFailed);
+        block.data = std::move(bwt_res.value());
+    }
+    return block;
+}
+
 std::expected<void, SplittingError> TransformSplitting::ApplyForward(
     const std::filesystem::path& in_path, const std::filesystem::path& out_path,
-    bool use_bwt, bool use_mtf)
+    bool use_bwt, bool use_mtf, unsigned threads, uint32_t block_size, size_t memory_budget, uint8_t bwt_chains, bool use_zero_runs)
 {
+    if (block_size == 0) block_size = DEFAULT_BLOCK_SIZE;
+    if (auto res = ValidateBlockSize(block_size, memory_budget); !res) {
+        std::println(stderr, "Splitting Error: {}", SplittingError_to_string(res.error()));
+        return res;
+    }
+    if (bwt_chains == 0) bwt_chains = 1;
+    if (bwt_chains > MAX_BWT_CHAINS) {
+        std::println(stderr, "Splitting Error: {}", SplittingError_to_string(SplittingError::InvalidChainCount));
+        return std::unexpected(SplittingError::InvalidChainCount);
+    }
+    if (!use_bwt) bwt_chains = 1;
+
     std::ifstream in(in_path, std::ios::binary);
     std::ofstream out(out_path, std::ios::binary);
     if (!in || !out) {
@@ -24,44 +110,66 @@ std::expected<void, SplittingError> TransformSplitting::ApplyForward(
         return std::unexpected(SplittingError::FileOpenError);
     }
 
-    std::vector<uint8_t> buffer(BLOCK_SIZE);
-    while (in.read(reinterpret_cast<char*>(buffer.data()), BLOCK_SIZE) || in.gcount() > 0) {
-        size_t bytes_read = in.gcount();
-        std::span<const uint8_t> current_span(buffer.data(), bytes_read);
-        std::vector<uint8_t> transformed;
-        uint32_t bwt_index = 0;
+    const uint8_t stream_flags = bwt_chains > 1 ? STREAM_FLAG_CHAINS : 0;
+    out.write(reinterpret_cast<const char*>(&STREAM_MARKER), sizeof(STREAM_MARKER));
+    out.write(reinterpret_cast<const char*>(&block_size), sizeof(block_size));
+    out.write(reinterpret_cast<const char*>(&stream_flags), 1);
+    if (stream_flags & STREAM_FLAG_CHAINS) out.write(reinterpret_cast<const char*>(&bwt_chains), 1);
 
-        if (use_bwt) {
-            auto bwt_res = BWT::Encode(current_span, bwt_index);
-            if (!bwt_res) {
-                std::println(stderr, "Splitting Error: {}", SplittingError_to_string(SplittingError::TransformFailed));
-                return std::unexpected(SplittingError::TransformFailed);
-            }
-            transformed = std::move(bwt_res.value());
-            current_span = transformed;
+    // Якщо блоків менше, ніж потоків, решта потоків сортує зсуви всередині блоку.
+    const unsigned workers = WorkerLimit(block_size, memory_budget, ENCODE_BYTES_PER_SYMBOL, threads);
+    std::error_code ec;
+    const uintmax_t input_size = std::filesystem::file_size(in_path, ec);
+    const uintmax_t block_count = ec ? workers : std::max<uintmax_t>(1, (input_size + block_size - 1) / block_size);
+    const unsigned block_workers = static_cast<unsigned>(std::min<uintmax_t>(workers, block_count));
+    const unsigned sort_threads = workers / block_workers;
+
+    ThreadPool pool(block_workers);
+    const size_t max_in_flight = 2 * pool.Size();
+    std::deque<std::future<std::expected<Block, SplittingError>>> pending;
+
+    auto write_front = [&]() -> std::expected<void, SplittingError> {
+        auto block = pending.front().get();
+        pending.pop_front();
+        if (!block) {
+            std::println(stderr, "Splitting Error: {}", SplittingError_to_string(block.error()));
+            return std::unexpected(block.error());
         }
-        if (use_mtf) {
-            auto mtf_res = MTF::Encode(current_span);
-            if (!mtf_res) {
-                std::println(stderr, "Splitting Error: {}", SplittingError_to_string(SplittingError::TransformFailed));
-                return std::unexpected(SplittingError::TransformFailed);
-            }
-            transformed = std::move(mtf_res.value());
-            current_span = transformed;
+
+        const uint32_t data_size = static_cast<uint32_t>(block->data.size());
+        out.write(reinterpret_cast<const char*>(&data_size), sizeof(data_size));
+        if (use_bwt) {
+            out.write(reinterpret_cast<const char*>(&block->bwt_index), sizeof(block->bwt_index));
+            out.write(reinterpret_cast<const char*>(block->chain_starts.data()), block->chain_starts.size() * sizeof(uint32_t));
         }
+        out.write(reinterpret_cast<const char*>(block->data.data()), block->data.size());
+        return {};
+    };
 
-        uint32_t block_size = static_cast<uint32_t>(current_span.size());
-        out.write(reinterpret_cast<const char*>(&block_size), sizeof(block_size));
-        if (use_bwt)
-            out.write(reinterpret_cast<const char*>(&bwt_index), sizeof(bwt_index));
-        out.write(reinterpret_cast<const char*>(current_span.data()), current_span.size());
+    while (true) {
+        std::vector<uint8_t> buffer(block_size);
+        in.read(reinterpret_cast<char*>(buffer.data()), block_size);
+        const size_t bytes_read = static_cast<size_t>(in.gcount());
+        if (bytes_read == 0) break;
+        buffer.resize(bytes_read);
+
+        pending.push_back(pool.Submit([buffer = std::move(buffer), use_bwt, use_mtf, use_zero_runs, sort_threads, bwt_chains] {
+            return ForwardBlock(buffer, use_bwt, use_mtf, use_zero_runs, sort_threads, bwt_chains);
+        }));
+
+        if (pending.size() >= max_in_flight) {
+            if (auto res = write_front(); !res) return res;
+        }
+    }
+    while (!pending.empty()) {
+        if (auto res = write_front(); !res) return res;
     }
     return {};
 }
 
 std::expected<void, SplittingError> TransformSplitting::ApplyReverse(
     const std::filesystem::path& in_path, const std::filesystem::path& out_path,
-    bool use_bwt, bool use_mtf)
+    bool use_bwt, bool use_mtf, unsigned threads, size_t memory_budget, bool use_zero_runs)
 {
     std::ifstream in(in_path, std::ios::binary);
     std::ofstream out(out_path, std::ios::binary);
@@ -70,41 +178,77 @@ std::expected<void, SplittingError> TransformSplitting::ApplyReverse(
         return std::unexpected(SplittingError::FileOpenError);
     }
 
-    while (in.peek() != EOF) {
-        uint32_t block_size = 0;
-        if (!in.read(reinterpret_cast<char*>(&block_size), sizeof(block_size))) break;
+    auto fail = [](SplittingError err) -> std::expected<void, SplittingError> {
+        std::println(stderr, "Splitting Error: {}", SplittingError_to_string(err));
+        return std::unexpected(err);
+    };
 
-        uint32_t bwt_index = 0;
-        if (use_bwt) {
-            if (!in.read(reinterpret_cast<char*>(&bwt_index), sizeof(bwt_index))) break;
+    uint32_t block_size = DEFAULT_BLOCK_SIZE;
+    uint8_t bwt_chains = 1;
+    uint32_t first_size = 0;
+    bool has_first = false;
+    if (in.read(reinterpret_cast<char*>(&first_size), sizeof(first_size))) {
+        if (first_size == STREAM_MARKER) {
+            uint8_t stream_flags = 0;
+            if (!in.read(reinterpret_cast<char*>(&block_size), sizeof(block_size)) ||
+                !in.read(reinterpret_cast<char*>(&stream_flags), 1) || (stream_flags & ~STREAM_FLAG_CHAINS) ||
+                block_size < MIN_BLOCK_SIZE || block_size > MAX_BLOCK_SIZE)
+                return fail(SplittingError::InvalidFormat);
+            if ((stream_flags & STREAM_FLAG_CHAINS) &&
+                (!in.read(reinterpret_cast<char*>(&bwt_chains), 1) || bwt_chains < 2 || bwt_chains > MAX_BWT_CHAINS))
+                return fail(SplittingError::InvalidFormat);
         }
+        else has_first = true;
+    }
 
-        std::vector<uint8_t> buffer(block_size);
-        if (!in.read(reinterpret_cast<char*>(buffer.data()), block_size)) break;
-
-        std::span<const uint8_t> current_span = buffer;
-        std::vector<uint8_t> restored;
-
-        if (use_mtf) {
-            auto mtf_res = MTF::Decode(current_span);
-            if (!mtf_res) {
-                std::println(stderr, "Splitting Error: {}", SplittingError_to_string(SplittingError::TransformFailed));
-                return std::unexpected(SplittingError::TransformFailed);
-            }
-            restored = std::move(mtf_res.value());
-            current_span = restored;
+    unsigned workers = WorkerLimit(block_size, memory_budget, DECODE_BYTES_PER_SYMBOL, threads);
+    // LF-відображення повільніше за масив переходів, тож вмикається лише тоді, коли той не вміщається зовсім.
+    const bool low_memory = use_bwt && workers == 0;
+    if (low_memory) workers = WorkerLimit(block_size, memory_budget, LOW_MEMORY_DECODE_BYTES_PER_SYMBOL, threads);
+    if (workers == 0) return fail(SplittingError::MemoryBudgetExceeded);
+
+    ThreadPool pool(workers);
+    const size_t max_in_flight = 2 * pool.Size();
+    std::deque<std::future<std::expected<Block, SplittingError>>> pending;
+
+    auto write_front = [&]() -> std::expected<void, SplittingError> {
+        auto block = pending.front().get();
+        pending.pop_front();
+        if (!block) {
+            std::println(stderr, "Splitting Error: {}", SplittingError_to_string(block.error()));
+            return std::unexpected(block.error());
         }
+        out.write(reinterpret_cast<const char*>(block->data.data()), block->data.size());
+        return {};
+    };
+
+    while (has_first || in.peek() != EOF) {
+        uint32_t data_size = first_size;
+        if (!has_first && !in.read(reinterpret_cast<char*>(&data_size), sizeof(data_size))) break;
+        has_first = false;
+        // Екрановані значення 254 і 255 можуть подвоїти блок після ZeroRun.
+        if (data_size > (use_zero_runs ? 2 * uint64_t(block_size) : block_size)) return fail(SplittingError::InvalidFormat);
+
+        Block block;
         if (use_bwt) {
-            auto bwt_res = BWT::Decode(current_span, bwt_index);
-            if (!bwt_res) {
-                std::println(stderr, "Splitting Error: {}", SplittingError_to_string(SplittingError::TransformFailed));
-                return std::unexpected(SplittingError::TransformFailed);
-            }
-            restored = std::move(bwt_res.value());
-            current_span = restored;
+            block.chain_starts.resize(bwt_chains - 1);
+            if (!in.read(reinterpret_cast<char*>(&block.bwt_index), sizeof(block.bwt_index)) ||
+                !in.read(reinterpret_cast<char*>(block.chain_starts.data()), block.chain_starts.size() * sizeof(uint32_t))) break;
         }
 
-        out.write(reinterpret_cast<const char*>(current_span.data()), current_span.size());
+        block.data.resize(data_size);
+        if (!in.read(reinterpret_cast<char*>(block.data.data()), data_size)) break;
+
+        pending.push_back(pool.Submit([block = std::move(block), use_bwt, use_mtf, use_zero_runs, block_size, low_memory]() mutable {
+            return ReverseBlock(std::move(block), use_bwt, use_mtf, use_zero_runs, block_size, low_memory);
+        }));
+
+        if (pending.size() >= max_in_flight) {
+            if (auto res = write_front(); !res) return res;
+        }
+    }
+    while (!pending.empty()) {
+        if (auto res = write_front(); !res) return res;
     }
     return {};
 }
\ No newline at end of file
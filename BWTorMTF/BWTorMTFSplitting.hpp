@@ -2,27 +2,83 @@
 
 #include <filesystem>
 #include <expected>
+#include <vector>
+#include <span>
+#include <cstdint>
 
 enum class SplittingError {
     FileOpenError,
-    TransformFailed
+    TransformFailed,
+    InvalidBlockSize,
+    MemoryBudgetExceeded,
+    InvalidFormat,
+    InvalidChainCount
 };
 
 std::string_view SplittingError_to_string(SplittingError err);
 
 class TransformSplitting {
     public:
-        static constexpr size_t BLOCK_SIZE = 256 * 1024;
+        static constexpr uint32_t DEFAULT_BLOCK_SIZE = 256 * 1024;
+        static constexpr uint32_t MIN_BLOCK_SIZE = 1024;
+        static constexpr uint32_t MAX_BLOCK_SIZE = 256u * 1024 * 1024;
+        static constexpr size_t DEFAULT_MEMORY_BUDGET = size_t(1) << 30;
+        static constexpr uint8_t MAX_BWT_CHAINS = 8;
 
+    // block_size == 0 та memory_budget == 0 означають значення за замовчуванням.
+    // bwt_chains > 1 зберігає в кожному блоці додаткові стартові рядки для паралельних ланцюжків зворотного BWT.
+    // use_zero_runs стискає серії нулів після MTF кодами RUNA/RUNB (див. ZeroRun) перед записом блоку.
     static std::expected<void, SplittingError> ApplyForward(
         const std::filesystem::path& in_path,
         const std::filesystem::path& out_path,
         bool use_bwt,
-        bool use_mtf);
+        bool use_mtf,
+        unsigned threads = 0,
+        uint32_t block_size = 0,
+        size_t memory_budget = 0,
+        uint8_t bwt_chains = 1,
+        bool use_zero_runs = false);
 
+    // Розмір блоку береться із заголовка потоку; потоки без заголовка мають блоки по DEFAULT_BLOCK_SIZE.
+    // Якщо звичайний зворотний BWT не вміщається в memory_budget, блоки декодуються через BWT::DecodeLowMemory.
     static std::expected<void, SplittingError> ApplyReverse(
         const std::filesystem::path& in_path,
         const std::filesystem::path& out_path,
         bool use_bwt,
-        bool use_mtf);
+        bool use_mtf,
+        unsigned threads = 0,
+        size_t memory_budget = 0,
+        bool use_zero_runs = false);
+
+    // Перевіряє, що розмір блоку в межах і хоча б один блок прямого перетворення вміщається в бюджет.
+    static std::expected<void, SplittingError> ValidateBlockSize(uint32_t block_size, size_t memory_budget = 0);
+
+private:
+    // Старі потоки починаються з довжини блоку <= 256 КіБ, тож маркер 0xFFFFFFFF однозначно вказує на заголовок.
+    static constexpr uint32_t STREAM_MARKER = 0xFFFFFFFFu;
+    // За прапорцем у заголовку йде u8 кількість ланцюжків, а кожен BWT-блок після bwt_index несе ще (chains - 1) u32.
+    static constexpr uint8_t STREAM_FLAG_CHAINS = 1;
+
+    // Оцінка пікової пам'яті на байт блоку: SA-IS по подвоєному блоку і зворотний BWT з масивом T.
+    static constexpr size_t ENCODE_BYTES_PER_SYMBOL = 48;
+    static constexpr size_t DECODE_BYTES_PER_SYMBOL = 8;
+    // Вхід, вейвлет-матриця (1.25 байта) і результат BWT::DecodeLowMemory.
+    static constexpr size_t LOW_MEMORY_DECODE_BYTES_PER_SYMBOL = 4;
+    // Вхід і результат блоків, що чекають у черзі на запис (до двох на потік).
+    static constexpr size_t QUEUED_BYTES_PER_SYMBOL = 4;
+
+    // Скільки потоків вміщається в бюджет; 0 — не вміщається навіть один блок.
+    static unsigned WorkerLimit(uint32_t block_size, size_t memory_budget, size_t bytes_per_symbol, unsigned threads);
+
+    struct Block {
+        std::vector<uint8_t> data;
+        uint32_t bwt_index = 0;
+        std::vector<uint32_t> chain_starts;
+    };
+
+    // Блоки незалежні, тож перетворюються у пулі потоків; запис іде строго в порядку читання.
+    static std::expected<Block, SplittingError> ForwardBlock(std::span<const uint8_t> input, bool use_bwt, bool use_mtf,
+        bool use_zero_runs, unsigned sort_threads, uint8_t bwt_chains);
+    static std::expected<Block, SplittingError> ReverseBlock(Block block, bool use_bwt, bool use_mtf, bool use_zero_runs,
+        uint32_t block_size, bool low_memory);
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 ﻿#include "../BitStream/BitStream.hpp"
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <print>
 
@@ -13,87 +14,114 @@ std::string_view error_to_string(BitStreamError err) {
     }
 }
 
-BitWriter::BitWriter(std::ostream& out) : out_(out) {}
+BitWriter::BitWriter(std::ostream& out)
+    : out_(&out), owned_(BUFFER_SIZE + SLACK_BYTES), buffer_(owned_), limit_(BUFFER_SIZE) {}
+
+BitWriter::BitWriter(std::vector<uint8_t>& sink) : buffer_(sink), pos_(sink.size()) {
+    buffer_.resize(pos_ + BUFFER_SIZE + SLACK_BYTES);
+    limit_ = pos_ + BUFFER_SIZE;
+}
 
 BitWriter::~BitWriter() {
     auto _ = Flush();
 }
 
-std::expected<void, BitStreamError> BitWriter::Flush() {
-    if (bit_pos_ > 0) {
-        out_.put(static_cast<char>(current_byte_));
-        if (out_.fail()) {
-            std::println(stderr, "BitWriter Flush Error: {}", error_to_string(BitStreamError::WriteError));
+std::expected<void, BitStreamError> BitWriter::FlushBuffer() {
+    if (!out_) {
+        buffer_.resize(pos_ + std::max(pos_, BUFFER_SIZE) + SLACK_BYTES);
+        limit_ = buffer_.size() - SLACK_BYTES;
+        return {};
+    }
+    if (pos_ > 0) {
+        out_->write(reinterpret_cast<const char*>(buffer_.data()), static_cast<std::streamsize>(pos_));
+        if (out_->fail()) {
+            std::println(stderr, "BitWriter Write Error: {}", error_to_string(BitStreamError::WriteError));
             return std::unexpected(BitStreamError::WriteError);
         }
-        current_byte_ = 0;
-        bit_pos_ = 0;
+        pos_ = 0;
     }
     return {};
 }
 
-std::expected<void, BitStreamError> BitWriter::WriteBitSequence(std::span<const uint8_t> data, size_t bit_length) {
-    size_t bits_written = 0;
-    for (uint8_t byte : data) {
-        for (int i = 0; i < 8; ++i) {
-            if (bits_written >= bit_length) return {};
-            uint8_t bit = (byte >> i) & 1;
-            current_byte_ |= (bit << bit_pos_);
-            bit_pos_++;
-            bits_written++;
-
-            if (bit_pos_ == 8) {
-                out_.put(static_cast<char>(current_byte_));
-                if (out_.fail()) {
-                    std::println(stderr, "BitWriter Write Error: {}", error_to_string(BitStreamError::WriteError));
-                    return std::unexpected(BitStreamError::WriteError);
-                }
-                current_byte_ = 0;
-                bit_pos_ = 0;
-            }
-        }
+std::expected<void, BitStreamError> BitWriter::Flush() {
+    if (acc_bits_ > 0) {
+        buffer_[pos_++] = static_cast<uint8_t>(acc_);
+        acc_ = 0;
+        acc_bits_ = 0;
+    }
+    if (!out_) {
+        buffer_.resize(pos_);
+        limit_ = pos_;
+        return {};
+    }
+    if (auto res = FlushBuffer(); !res) {
+        std::println(stderr, "BitWriter Flush Error: {}", error_to_string(res.error()));
+        return res;
     }
     return {};
 }
 
-BitReader::BitReader(std::istream& in) : in_(in) {}
+std::expected<void, BitStreamError> BitWriter::WriteBitSequence(std::span<const uint8_t> data, size_t bit_length) {
+    bit_length = std::min(bit_length, data.size() * 8);
+    size_t byte_idx = 0;
+    while (bit_length > 0) {
+        unsigned n = static_cast<unsigned>(std::min<size_t>(bit_length, MAX_BITS_PER_WRITE));
+        uint64_t value = 0;
+        for (unsigned i = 0; i * 8 < n; ++i)
+            value |= static_cast<uint64_t>(data[byte_idx + i]) << (i * 8);
+        if (auto res = WriteBits(value, n); !res) return res;
+        byte_idx += MAX_BITS_PER_WRITE / 8;
+        bit_length -= n;
+    }
+    return {};
+}
 
-std::expected<void, BitStreamError> BitReader::ReadBitSequence(std::span<uint8_t> data, size_t bit_length) {
-    std::ranges::fill(data, 0);
+BitReader::BitReader(std::istream& in)
+    : in_(&in), buffer_(BUFFER_SIZE), cur_(buffer_.data()), end_(buffer_.data()) {}
 
-    size_t bits_read = 0;
-    size_t byte_idx = 0;
-    uint8_t dest_bit_pos = 0;
+BitReader::BitReader(std::span<const uint8_t> data) : cur_(data.data()), end_(data.data() + data.size()) {}
 
-    while (bits_read < bit_length) {
-        if (bit_pos_ == 8) {
-            char c;
-            if (!in_.get(c)) {
-                std::println(stderr, "BitReader Read Error: {}", error_to_string(BitStreamError::EndOfFile));
-                return std::unexpected(BitStreamError::EndOfFile);
-            }
-            current_byte_ = static_cast<uint8_t>(c);
-            bit_pos_ = 0;
+void BitReader::RefillSlow() {
+    if (in_ && in_->good()) {
+        size_t tail = static_cast<size_t>(end_ - cur_);
+        std::memmove(buffer_.data(), cur_, tail);
+        in_->read(reinterpret_cast<char*>(buffer_.data() + tail), static_cast<std::streamsize>(buffer_.size() - tail));
+        cur_ = buffer_.data();
+        end_ = cur_ + tail + static_cast<size_t>(in_->gcount());
+        if (end_ - cur_ >= 8) {
+            Refill();
+            return;
         }
+    }
+    while (acc_bits_ <= 56 && cur_ != end_) {
+        acc_ |= static_cast<uint64_t>(*cur_++) << acc_bits_;
+        acc_bits_ += 8;
+    }
+}
 
-        uint8_t bit = (current_byte_ >> bit_pos_) & 1;
-        bit_pos_++;
+std::expected<void, BitStreamError> BitReader::EndOfStream() const {
+    BitStreamError err = (in_ && in_->bad()) ? BitStreamError::ReadError : BitStreamError::EndOfFile;
+    std::println(stderr, "BitReader Read Error: {}", error_to_string(err));
+    return std::unexpected(err);
+}
 
-        if (byte_idx < data.size()) {
-            data[byte_idx] |= (bit << dest_bit_pos);
-            dest_bit_pos++;
+std::expected<void, BitStreamError> BitReader::ReadBitSequence(std::span<uint8_t> data, size_t bit_length) {
+    std::ranges::fill(data, 0);
 
-            if (dest_bit_pos == 8) {
-                dest_bit_pos = 0;
-                byte_idx++;
-            }
-        }
-        else {
-			std::println(stderr, "BitReader Read Error: {}", error_to_string(BitStreamError::BufferTooSmall));
-            return std::unexpected(BitStreamError::BufferTooSmall);
-        }
+    if (bit_length > data.size() * 8) {
+        std::println(stderr, "BitReader Read Error: {}", error_to_string(BitStreamError::BufferTooSmall));
+        return std::unexpected(BitStreamError::BufferTooSmall);
+    }
 
-        bits_read++;
+    size_t byte_idx = 0;
+    while (bit_length > 0) {
+        unsigned n = static_cast<unsigned>(std::min<size_t>(bit_length, MAX_BITS_PER_READ));
+        auto value = ReadBits(n);
+        if (!value) return std::unexpected(value.error());
+        for (unsigned i = 0; i * 8 < n; ++i)
+            data[byte_idx + i] = static_cast<uint8_t>(value.value() >> (i * 8));
+        byte_idx += MAX_BITS_PER_READ / 8;
+        bit_length -= n;
     }
     return {};
 }
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include <iostream>
 #include <span>
 #include <cstdint>
+#include <cstring>
+#include <bit>
 #include <expected>
 #include <vector>
 #include <string_view>
@@ -16,35 +18,154 @@ enum class BitStreamError {
 
 std::string_view error_to_string(BitStreamError err);
 
+inline uint64_t LoadLE64(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    if constexpr (std::endian::native == std::endian::big) v = std::byteswap(v);
+    return v;
+}
+
+inline void StoreLE64(uint8_t* p, uint64_t v) {
+    if constexpr (std::endian::native == std::endian::big) v = std::byteswap(v);
+    std::memcpy(p, &v, sizeof(v));
+}
+
 class BitWriter {
 public:
+    static constexpr unsigned MAX_BITS_PER_WRITE = 56;
+
     explicit BitWriter(std::ostream& out);
+    explicit BitWriter(std::vector<uint8_t>& sink);
     ~BitWriter();
 
     BitWriter(const BitWriter&) = delete;
     BitWriter& operator=(const BitWriter&) = delete;
 
+    std::expected<void, BitStreamError> WriteBits(uint64_t value, unsigned n);
+
+    // Пакетний запис без перевірок: між DrainBits() — не більше 56 бітів,
+    // між EnsureCapacity() — не більше 64 бітів; value не повинно мати зайвих старших бітів.
+    std::expected<void, BitStreamError> EnsureCapacity();
+    void AppendBits(uint64_t value, unsigned n);
+    void DrainBits();
+
     std::expected<void, BitStreamError> WriteBitSequence(std::span<const uint8_t> data, size_t bit_length);
 
     std::expected<void, BitStreamError> Flush();
 
 private:
-    std::ostream& out_;
-    uint8_t current_byte_ = 0;
-    uint8_t bit_pos_ = 0;
+    static constexpr size_t BUFFER_SIZE = 256 * 1024;
+    static constexpr size_t SLACK_BYTES = 16;
+
+    std::expected<void, BitStreamError> FlushBuffer();
+
+    std::ostream* out_ = nullptr;
+    std::vector<uint8_t> owned_;
+    std::vector<uint8_t>& buffer_;
+    size_t pos_ = 0;
+    size_t limit_ = 0;
+    uint64_t acc_ = 0;
+    unsigned acc_bits_ = 0;
 };
 
 class BitReader {
 public:
+    static constexpr unsigned MAX_BITS_PER_READ = 56;
+    static constexpr unsigned MAX_PEEK_BITS = 57;
+
     explicit BitReader(std::istream& in);
+    explicit BitReader(std::span<const uint8_t> data);
 
     BitReader(const BitReader&) = delete;
     BitReader& operator=(const BitReader&) = delete;
 
+    // Після Refill() доступно щонайменше MAX_PEEK_BITS бітів, якщо потік не закінчився.
+    // Біти за кінцем потоку читаються через PeekBits як нулі; помилку EndOfFile
+    // повертає лише ConsumeBits/ReadBits, коли справжніх бітів не вистачає.
+    void Refill();
+    uint64_t PeekBits(unsigned n) const { return acc_ & ((1ULL << n) - 1); }
+    std::expected<void, BitStreamError> ConsumeBits(unsigned n);
+    unsigned AvailableBits() const { return acc_bits_; }
+
+    std::expected<uint64_t, BitStreamError> ReadBits(unsigned n);
+
     std::expected<void, BitStreamError> ReadBitSequence(std::span<uint8_t> data, size_t bit_length);
 
 private:
-    std::istream& in_;
-    uint8_t current_byte_ = 0;
-    uint8_t bit_pos_ = 8;
-};
\ No newline at end of file
+    static constexpr size_t BUFFER_SIZE = 256 * 1024;
+
+    void RefillSlow();
+    std::expected<void, BitStreamError> EndOfStream() const;
+
+    std::istream* in_ = nullptr;
+    std::vector<uint8_t> buffer_;
+    const uint8_t* cur_ = nullptr;
+    const uint8_t* end_ = nullptr;
+    uint64_t acc_ = 0;
+    unsigned acc_bits_ = 0;
+};
+
+inline std::expected<void, BitStreamError> BitWriter::EnsureCapacity() {
+    if (pos_ >= limit_) return FlushBuffer();
+    return {};
+}
+
+inline void BitWriter::AppendBits(uint64_t value, unsigned n) {
+    acc_ |= value << acc_bits_;
+    acc_bits_ += n;
+}
+
+inline void BitWriter::DrainBits() {
+    StoreLE64(buffer_.data() + pos_, acc_);
+    pos_ += acc_bits_ >> 3;
+    acc_ >>= (acc_bits_ & ~7u);
+    acc_bits_ &= 7;
+}
+
+inline std::expected<void, BitStreamError> BitWriter::WriteBits(uint64_t value, unsigned n) {
+    if (n > MAX_BITS_PER_WRITE) {
+        if (auto res = WriteBits(value, 32); !res) return res;
+        return WriteBits(value >> 32, n - 32);
+    }
+    if (auto res = EnsureCapacity(); !res) return res;
+    AppendBits(value & ((1ULL << n) - 1), n);
+    DrainBits();
+    return {};
+}
+
+inline void BitReader::Refill() {
+    if (acc_bits_ >= MAX_PEEK_BITS) return;
+    if (end_ - cur_ < 8) {
+        RefillSlow();
+        return;
+    }
+    acc_ |= LoadLE64(cur_) << acc_bits_;
+    unsigned bytes = (64 - acc_bits_) >> 3;
+    cur_ += bytes;
+    acc_bits_ += bytes << 3;
+}
+
+inline std::expected<void, BitStreamError> BitReader::ConsumeBits(unsigned n) {
+    if (n > acc_bits_) return EndOfStream();
+    acc_ >>= n;
+    acc_bits_ -= n;
+    return {};
+}
+
+inline std::expected<uint64_t, BitStreamError> BitReader::ReadBits(unsigned n) {
+    if (n > MAX_BITS_PER_READ) {
+        auto low = ReadBits(32);
+        if (!low) return low;
+        auto high = ReadBits(n - 32);
+        if (!high) return high;
+        return low.value() | (high.value() << 32);
+    }
+    if (acc_bits_ < n) {
+        Refill();
+        if (acc_bits_ < n) return std::unexpected(EndOfStream().error());
+    }
+    uint64_t value = PeekBits(n);
+    acc_ >>= n;
+    acc_bits_ -= n;
+    return value;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+
+// Читає argv[i + 1] як десяткове ціле в межах [min, max] і зсуває i на нього.
+// std::nullopt — значення немає, воно не є числом або виходить за межі.
+inline std::optional<uint64_t> ParseUnsigned(int argc, char* argv[], int& i, uint64_t min, uint64_t max) {
+    if (i + 1 >= argc) return std::nullopt;
+    const char* text = argv[++i];
+    const char* end = text + std::strlen(text);
+    uint64_t value = 0;
+    const auto [ptr, ec] = std::from_chars(text, end, value);
+    if (ec != std::errc() || ptr != end || value < min || value > max) return std::nullopt;
+    return value;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define BITSTREAM_X86_64 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define BITSTREAM_TARGET_AVX2
+#else
+#define BITSTREAM_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#include <immintrin.h>
+#endif
+
+class CpuFeatures {
+public:
+    static bool HasAVX2() {
+        static const bool supported = DetectAVX2();
+        return supported;
+    }
+
+private:
+    static bool DetectAVX2() {
+#if defined(BITSTREAM_X86_64) && defined(_MSC_VER)
+        int regs[4];
+        __cpuid(regs, 0);
+        if (regs[0] < 7) return false;
+        __cpuid(regs, 1);
+        const bool osxsave = (regs[2] & (1 << 27)) != 0;
+        const bool avx = (regs[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) return false;
+        __cpuidex(regs, 7, 0);
+        return (regs[1] & (1 << 5)) != 0;
+#elif defined(BITSTREAM_X86_64)
+        return __builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
+    }
+};
@@ -0,0 +1,94 @@
+﻿#include "Histogram.hpp"
+#include "CpuFeatures.hpp"
+#include "BitStream.hpp"
+#include <algorithm>
+
+namespace {
+    // 32-бітні лічильники підтаблиць скидаються у freqs кожні CHUNK_SIZE байтів.
+    constexpr size_t CHUNK_SIZE = size_t(1) << 30;
+
+    template <size_t Tables>
+    void MergeTables(const uint32_t (&tables)[Tables][256], std::array<uint64_t, 256>& freqs) {
+        for (int s = 0; s < 256; ++s) {
+            uint64_t sum = 0;
+            for (size_t t = 0; t < Tables; ++t) sum += tables[t][s];
+            freqs[s] += sum;
+        }
+    }
+
+    void AccumulateScalar(const uint8_t* p, size_t n, std::array<uint64_t, 256>& freqs) {
+        uint32_t tables[4][256] = {};
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            const uint64_t w = LoadLE64(p + i);
+            tables[0][w & 0xFF]++;
+            tables[1][(w >> 8) & 0xFF]++;
+            tables[2][(w >> 16) & 0xFF]++;
+            tables[3][(w >> 24) & 0xFF]++;
+            tables[0][(w >> 32) & 0xFF]++;
+            tables[1][(w >> 40) & 0xFF]++;
+            tables[2][(w >> 48) & 0xFF]++;
+            tables[3][w >> 56]++;
+        }
+        for (; i < n; ++i) tables[0][p[i]]++;
+        MergeTables(tables, freqs);
+    }
+
+#ifdef BITSTREAM_X86_64
+    // Той самий скалярний підрахунок по 8 підтаблицях; від AVX2 тут лише перевірка 32-байтної серії,
+    // яка на довгих серіях (типових після BWT/MTF) пропускає ланцюжок залежних інкрементів.
+    BITSTREAM_TARGET_AVX2
+    void AccumulateAVX2(const uint8_t* p, size_t n, std::array<uint64_t, 256>& freqs) {
+        uint32_t tables[8][256] = {};
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+            // Серія одного байта: один інкремент замість 32 залежних.
+            const __m256i first = _mm256_set1_epi8(static_cast<char>(p[i]));
+            if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, first)) == -1) {
+                tables[0][p[i]] += 32;
+                continue;
+            }
+            const __m128i lo = _mm256_castsi256_si128(v);
+            const __m128i hi = _mm256_extracti128_si256(v, 1);
+            const uint64_t words[4] = {
+                static_cast<uint64_t>(_mm_cvtsi128_si64(lo)),
+                static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(lo, lo))),
+                static_cast<uint64_t>(_mm_cvtsi128_si64(hi)),
+                static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(hi, hi)))
+            };
+            for (uint64_t w : words) {
+                tables[0][w & 0xFF]++;
+                tables[1][(w >> 8) & 0xFF]++;
+                tables[2][(w >> 16) & 0xFF]++;
+                tables[3][(w >> 24) & 0xFF]++;
+                tables[4][(w >> 32) & 0xFF]++;
+                tables[5][(w >> 40) & 0xFF]++;
+                tables[6][(w >> 48) & 0xFF]++;
+                tables[7][w >> 56]++;
+            }
+        }
+        for (; i < n; ++i) tables[0][p[i]]++;
+        MergeTables(tables, freqs);
+    }
+#endif
+}
+
+void Histogram::Accumulate(std::span<const uint8_t> data, std::array<uint64_t, 256>& freqs) {
+#ifdef BITSTREAM_X86_64
+    const bool use_avx2 = CpuFeatures::HasAVX2();
+#endif
+    while (!data.empty()) {
+        const size_t n = std::min(data.size(), CHUNK_SIZE);
+#ifdef BITSTREAM_X86_64
+        if (use_avx2) AccumulateAVX2(data.data(), n, freqs);
+        else
+#endif
+            AccumulateScalar(data.data(), n, freqs);
+        data = data.subspan(n);
+    }
+}
+
+uint32_t Histogram::UniqueSymbols(const std::array<uint64_t, 256>& freqs) {
+    return static_cast<uint32_t>(std::count_if(freqs.begin(), freqs.end(), [](uint64_t f) { return f != 0; }));
+}
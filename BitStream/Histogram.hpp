@@ -0,0 +1,14 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+class Histogram {
+public:
+    // Додає частоти байтів data до freqs. Підрахунок скалярний по кількох підтаблицях; на x86-64 з AVX2
+    // 32-байтні серії одного байта розпізнаються векторним порівнянням і додаються одним інкрементом.
+    static void Accumulate(std::span<const uint8_t> data, std::array<uint64_t, 256>& freqs);
+
+    static uint32_t UniqueSymbols(const std::array<uint64_t, 256>& freqs);
+};
@@ -0,0 +1,176 @@
+﻿#include "MappedFile.hpp"
+#include <utility>
+#include <print>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::expected<MappedFile, BitStreamError> MappedFile::Open(const std::filesystem::path& path) {
+    MappedFile mf;
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::println(stderr, "MappedFile Error: {}", error_to_string(BitStreamError::ReadError));
+        return std::unexpected(BitStreamError::ReadError);
+    }
+    mf.file_ = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        std::println(stderr, "MappedFile Error: {}", error_to_string(BitStreamError::ReadError));
+        return std::unexpected(BitStreamError::ReadError);
+    }
+    mf.size_ = static_cast<size_t>(size.QuadPart);
+    if (mf.size_ == 0) return mf;
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        std::println(stderr, "MappedFile Error: {}", error_to_string(BitStreamError::ReadError));
+        return std::unexpected(BitStreamError::ReadError);
+    }
+    mf.mapping_ = mapping;
+
+    mf.data_ = static_cast<uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!mf.data_) {
+        std::println(stderr, "MappedFile Error: {}", error_to_string(BitStreamError::ReadError));
+        return std::unexpected(BitStreamError::ReadError);
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::println(stderr, "MappedFile Error: {}", error_to_string(BitStreamError::ReadError));
+        return std::unexpected(BitStreamError::ReadError);
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        std::println(stderr, "MappedFile Error: {}", error_to_string(BitStreamError::ReadError));
+        return std::unexpected(BitStreamError::ReadError);
+    }
+    mf.size_ = static_cast<size_t>(st.st_size);
+    if (mf.size_ == 0) {
+        ::close(fd);
+        return mf;
+    }
+
+    void* addr = ::mmap(nullptr, mf.size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        mf.size_ = 0;
+        std::println(stderr, "MappedFile Error: {}", error_to_string(BitStreamError::ReadError));
+        return std::unexpected(BitStreamError::ReadError);
+    }
+    ::madvise(addr, mf.size_, MADV_SEQUENTIAL);
+    mf.data_ = static_cast<uint8_t*>(addr);
+#endif
+    return mf;
+}
+
+std::expected<MappedFile, BitStreamError> MappedFile::Create(const std::filesystem::path& path, size_t size) {
+    MappedFile mf;
+    mf.writable_ = true;
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+        CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::println(stderr, "MappedFile Error: {}", error_to_string(BitStreamError::WriteError));
+        return std::unexpected(BitStreamError::WriteError);
+    }
+    mf.file_ = file;
+    if (size == 0) return mf;
+    mf.size_ = size;
+
+    const auto size64 = static_cast<uint64_t>(size);
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE,
+        static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64 & 0xFFFFFFFF), nullptr);
+    if (!mapping) {
+        std::println(stderr, "MappedFile Error: {}", error_to_string(BitStreamError::WriteError));
+        return std::unexpected(BitStreamError::WriteError);
+    }
+    mf.mapping_ = mapping;
+
+    mf.data_ = static_cast<uint8_t*>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0));
+    if (!mf.data_) {
+        std::println(stderr, "MappedFile Error: {}", error_to_string(BitStreamError::WriteError));
+        return std::unexpected(BitStreamError::WriteError);
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::println(stderr, "MappedFile Error: {}", error_to_string(BitStreamError::WriteError));
+        return std::unexpected(BitStreamError::WriteError);
+    }
+    if (size == 0) {
+        ::close(fd);
+        return mf;
+    }
+
+    if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        ::close(fd);
+        std::println(stderr, "MappedFile Error: {}", error_to_string(BitStreamError::WriteError));
+        return std::unexpected(BitStreamError::WriteError);
+    }
+
+    void* addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        std::println(stderr, "MappedFile Error: {}", error_to_string(BitStreamError::WriteError));
+        return std::unexpected(BitStreamError::WriteError);
+    }
+    mf.size_ = size;
+    mf.data_ = static_cast<uint8_t*>(addr);
+#endif
+    return mf;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)),
+    writable_(std::exchange(other.writable_, false))
+#ifdef _WIN32
+    , file_(std::exchange(other.file_, nullptr)), mapping_(std::exchange(other.mapping_, nullptr))
+#endif
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        Close();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        writable_ = std::exchange(other.writable_, false);
+#ifdef _WIN32
+        file_ = std::exchange(other.file_, nullptr);
+        mapping_ = std::exchange(other.mapping_, nullptr);
+#endif
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+void MappedFile::Close() {
+#ifdef _WIN32
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle(mapping_);
+    if (file_) CloseHandle(file_);
+    mapping_ = nullptr;
+    file_ = nullptr;
+#else
+    if (data_) ::munmap(data_, size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    writable_ = false;
+}
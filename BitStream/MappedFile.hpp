@@ -0,0 +1,36 @@
+#pragma once
+
+#include "BitStream.hpp"
+#include <filesystem>
+#include <span>
+#include <cstdint>
+#include <expected>
+
+class MappedFile {
+public:
+    static std::expected<MappedFile, BitStreamError> Open(const std::filesystem::path& path);
+    // Створює (або перезаписує) файл заданого розміру і відображає його для запису.
+    static std::expected<MappedFile, BitStreamError> Create(const std::filesystem::path& path, size_t size);
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::span<const uint8_t> Data() const { return { data_, size_ }; }
+    std::span<uint8_t> MutableData() { return writable_ ? std::span<uint8_t>(data_, size_) : std::span<uint8_t>(); }
+
+private:
+    MappedFile() = default;
+    void Close();
+
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    bool writable_ = false;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
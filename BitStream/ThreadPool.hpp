@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool {
+public:
+    static constexpr unsigned MAX_THREADS = 256;
+
+    explicit ThreadPool(unsigned threads = 0) {
+        if (threads == 0) threads = DefaultThreads();
+        threads = std::min(threads, MAX_THREADS);
+        workers_.reserve(threads);
+        for (unsigned i = 0; i < threads; ++i)
+            workers_.emplace_back([this] { WorkerLoop(); });
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto& worker : workers_) worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template <class F>
+    auto Submit(F&& task) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using Result = std::invoke_result_t<std::decay_t<F>>;
+        auto job = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        auto future = job->get_future();
+        {
+            std::lock_guard lock(mutex_);
+            tasks_.emplace([job] { (*job)(); });
+        }
+        cv_.notify_one();
+        return future;
+    }
+
+    unsigned Size() const { return static_cast<unsigned>(workers_.size()); }
+
+    static unsigned DefaultThreads() {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Потоків для tasks незалежних завдань: 0 — усі ядра, але не більше завдань і не більше MAX_THREADS.
+    static unsigned WorkerCount(unsigned threads, uint64_t tasks) {
+        if (threads == 0) threads = DefaultThreads();
+        return static_cast<unsigned>(std::clamp<uint64_t>(std::min<uint64_t>(threads, tasks), 1, MAX_THREADS));
+    }
+
+private:
+    void WorkerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock lock(mutex_);
+                cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+                if (stop_ && tasks_.empty()) return;
+                task = std::move(tasks_.front());
+                tasks_.pop();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+};
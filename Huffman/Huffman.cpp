@@ -1,8 +1,15 @@
 ﻿#include "Huffman.hpp"
+#include "HuffmanTable.hpp"
 #include "../BitStream/BitStream.hpp"
+#include "../BitStream/MappedFile.hpp"
+#include "../BitStream/ThreadPool.hpp"
+#include "../BitStream/Histogram.hpp"
 #include "../BWTorMTF/BWTorMTFSplitting.hpp"
 #include <fstream>
 #include <queue>
+#include <deque>
+#include <future>
+#include <limits>
 
 namespace {
     struct TempFile {
@@ -25,29 +32,301 @@ std::string_view HuffmanError_to_string(HuffmanError err) {
     case HuffmanError::FileSameAsInput: return "Вихідний файл не може бути тим самим, що і вхідний.";
     case HuffmanError::TransformFailed: return "Помилка при застосуванні перетворень BWT/MTF.";
 	case HuffmanError::NoPathProvided:  return "Не вказано шлях до файлу.";
+    case HuffmanError::InvalidCodeLength: return "Некоректна максимальна довжина коду. Дозволено діапазон 8-15 бітів.";
+    case HuffmanError::InvalidBlockSize:  return "Некоректний розмір блоку. Максимум 256 МіБ.";
+    case HuffmanError::InvalidBwtBlockSize: return "Некоректний розмір блоку BWT: від 1 КіБ до 256 МіБ і в межах бюджету пам'яті.";
+    case HuffmanError::InvalidBwtMemory:  return "Некоректний обсяг пам'яті BWT. Допустимо від 1 МіБ до 64 ГіБ.";
+    case HuffmanError::InvalidBwtChains:  return "Некоректна кількість ланцюжків BWT. Допустимо від 1 до 8.";
+    case HuffmanError::InvalidThreadCount: return "Некоректна кількість потоків. Допустимо від 0 (усі ядра) до 256.";
     default:                            return "Сталася невідома помилка при роботі з архіватором.";
     }
 }
 
-std::vector<uint8_t> HuffmanCoder::PackBits(const std::vector<bool>& bits) {
-    std::vector<uint8_t> bytes((bits.size() + 7) / 8, 0);
-    for (size_t i = 0; i < bits.size(); ++i)
-        if (bits[i]) bytes[i / 8] |= (1 << (i % 8));
-    return bytes;
-}
-
-void HuffmanCoder::BuildCodes(Node* node, std::vector<bool>& current_path, std::array<Code, 256>& codes) {
+void HuffmanCoder::BuildCodes(const Node* node, uint64_t path, unsigned depth,
+    std::array<uint64_t, 256>& codes, std::array<uint8_t, 256>& lengths)
+{
     if (node->is_leaf()) {
-        codes[node->symbol] = { PackBits(current_path), current_path.size() };
+        codes[node->symbol] = path;
+        lengths[node->symbol] = static_cast<uint8_t>(std::min(depth, 255u));
         return;
     }
-    current_path.push_back(false);
-    BuildCodes(node->left, current_path, codes);
-    current_path.pop_back();
+    uint64_t bit = depth < 64 ? (1ULL << depth) : 0;
+    BuildCodes(node->left, path, depth + 1, codes, lengths);
+    BuildCodes(node->right, path | bit, depth + 1, codes, lengths);
+}
+
+std::expected<void, BitStreamError> HuffmanCoder::EncodeStream(
+    std::span<const uint8_t> data, const std::array<Code, 256>& codes, BitWriter& bw)
+{
+    const uint8_t* p = data.data();
+    const size_t n = data.size();
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        if (auto res = bw.EnsureCapacity(); !res) return res;
+        const Code c0 = codes[p[i]];
+        const Code c1 = codes[p[i + 1]];
+        const Code c2 = codes[p[i + 2]];
+        const Code c3 = codes[p[i + 3]];
+        bw.AppendBits(c0.bits, c0.len);
+        bw.AppendBits(c1.bits, c1.len);
+        bw.DrainBits();
+        bw.AppendBits(c2.bits, c2.len);
+        bw.AppendBits(c3.bits, c3.len);
+        bw.DrainBits();
+    }
+    for (; i < n; ++i) {
+        if (auto res = bw.WriteBits(codes[p[i]].bits, codes[p[i]].len); !res) return res;
+    }
+    return {};
+}
+
+std::expected<void, BitStreamError> HuffmanCoder::EncodeStreams(
+    std::span<const uint8_t> data, const std::array<Code, 256>& codes, std::span<BitWriter* const, 4> streams)
+{
+    const uint8_t* p = data.data();
+    const size_t n = data.size();
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        for (size_t k = 0; k < 4; ++k) {
+            BitWriter& bw = *streams[k];
+            if (auto res = bw.EnsureCapacity(); !res) return res;
+            const Code c0 = codes[p[i + k]];
+            const Code c1 = codes[p[i + 4 + k]];
+            bw.AppendBits(c0.bits, c0.len);
+            bw.AppendBits(c1.bits, c1.len);
+            bw.DrainBits();
+        }
+    }
+    for (; i < n; ++i) {
+        if (auto res = streams[i % 4]->WriteBits(codes[p[i]].bits, codes[p[i]].len); !res) return res;
+    }
+    return {};
+}
+
+std::expected<HuffmanCoder::EncodedBlock, HuffmanError> HuffmanCoder::EncodeBlock(
+    std::span<const uint8_t> data, uint8_t max_code_length, bool four_streams)
+{
+    std::array<uint64_t, 256> freqs = { 0 };
+    Histogram::Accumulate(data, freqs);
+
+    bool is_single_symbol = (Histogram::UniqueSymbols(freqs) == 1);
+    four_streams = four_streams && !is_single_symbol;
+
+    auto lengths = HuffmanCodeBuilder::BuildLengths(freqs, max_code_length);
+    auto packed_lengths = HuffmanCodeBuilder::PackLengths(lengths);
+
+    EncodedBlock block;
+    block.payload.reserve(1 + packed_lengths.size());
+    block.payload.push_back((is_single_symbol ? BLOCK_SINGLE_SYMBOL : 0) | (four_streams ? BLOCK_FOUR_STREAMS : 0));
+    block.payload.insert(block.payload.end(), packed_lengths.begin(), packed_lengths.end());
+    block.metadata_size = block.payload.size();
+    if (is_single_symbol) return block;
+
+    auto canonical = HuffmanCodeBuilder::BuildCanonicalCodes(lengths);
+    std::array<Code, 256> codes;
+    for (int i = 0; i < 256; ++i)
+        codes[i] = { static_cast<uint32_t>(canonical[i]), lengths[i] };
+
+    if (four_streams) {
+        std::array<std::vector<uint8_t>, 4> stream_data;
+        {
+            BitWriter w0(stream_data[0]), w1(stream_data[1]), w2(stream_data[2]), w3(stream_data[3]);
+            std::array<BitWriter*, 4> writers = { &w0, &w1, &w2, &w3 };
+            if (!EncodeStreams(data, codes, writers)) return std::unexpected(HuffmanError::FileWriteError);
+        }
+        for (int k = 0; k < 3; ++k) {
+            uint32_t size = static_cast<uint32_t>(stream_data[k].size());
+            auto bytes = reinterpret_cast<const uint8_t*>(&size);
+            block.payload.insert(block.payload.end(), bytes, bytes + sizeof(size));
+        }
+        block.metadata_size += 3 * sizeof(uint32_t);
+        for (const auto& part : stream_data)
+            block.payload.insert(block.payload.end(), part.begin(), part.end());
+    }
+    else {
+        BitWriter bw(block.payload);
+        if (!EncodeStream(data, codes, bw)) return std::unexpected(HuffmanError::FileWriteError);
+    }
+    return block;
+}
+
+std::expected<void, HuffmanError> HuffmanCoder::DecodeBlock(
+    std::span<const uint8_t> payload, std::span<uint8_t> out)
+{
+    if (payload.size() < 1 + 128) return std::unexpected(HuffmanError::InvalidFormat);
+    const uint8_t block_flags = payload[0];
+    auto lengths = HuffmanCodeBuilder::UnpackLengths(payload.subspan<1, 128>());
+    payload = payload.subspan(1 + 128);
+
+    if (block_flags & BLOCK_SINGLE_SYMBOL) {
+        int symbol = -1;
+        for (int i = 0; i < 256; ++i) {
+            if (lengths[i] == 0) continue;
+            if (symbol >= 0) return std::unexpected(HuffmanError::InvalidFormat);
+            symbol = i;
+        }
+        if (symbol < 0) return std::unexpected(HuffmanError::InvalidFormat);
+        std::fill(out.begin(), out.end(), static_cast<uint8_t>(symbol));
+        return {};
+    }
+
+    if (!HuffmanCodeBuilder::IsComplete(lengths, HuffmanCodeBuilder::MAX_LENGTH_LIMIT))
+        return std::unexpected(HuffmanError::InvalidFormat);
+
+    HuffmanDecodeTable table;
+    if (!table.Build(HuffmanCodeBuilder::BuildCanonicalCodes(lengths), lengths))
+        return std::unexpected(HuffmanError::InvalidFormat);
+
+    if (block_flags & BLOCK_FOUR_STREAMS) {
+        if (payload.size() < 3 * sizeof(uint32_t)) return std::unexpected(HuffmanError::InvalidFormat);
+        std::array<uint32_t, 3> stream_sizes;
+        std::memcpy(stream_sizes.data(), payload.data(), sizeof(stream_sizes));
+        payload = payload.subspan(sizeof(stream_sizes));
+
+        std::array<std::span<const uint8_t>, 4> parts;
+        for (int k = 0; k < 3; ++k) {
+            if (stream_sizes[k] > payload.size()) return std::unexpected(HuffmanError::InvalidFormat);
+            parts[k] = payload.first(stream_sizes[k]);
+            payload = payload.subspan(stream_sizes[k]);
+        }
+        parts[3] = payload;
+
+        BitReader streams[4] = { BitReader(parts[0]), BitReader(parts[1]), BitReader(parts[2]), BitReader(parts[3]) };
+        if (!table.Decode(streams, out)) return std::unexpected(HuffmanError::InvalidFormat);
+    }
+    else {
+        BitReader br(payload);
+        if (!table.Decode(br, out)) return std::unexpected(HuffmanError::InvalidFormat);
+    }
+    return {};
+}
+
+std::expected<uintmax_t, HuffmanError> HuffmanCoder::CompressBlocks(
+    std::istream& in, std::ostream& out, uint32_t block_size,
+    uint8_t max_code_length, bool four_streams, unsigned threads)
+{
+    struct PendingBlock {
+        uint32_t raw_size;
+        std::future<std::expected<EncodedBlock, HuffmanError>> result;
+    };
+
+    ThreadPool pool(threads);
+    const size_t max_in_flight = 2 * pool.Size();
+    std::deque<PendingBlock> pending;
+    std::vector<BlockIndexEntry> index;
+    uintmax_t meta_size = 0;
+
+    auto write_front = [&]() -> std::expected<void, HuffmanError> {
+        PendingBlock front = std::move(pending.front());
+        pending.pop_front();
+        auto block = front.result.get();
+        if (!block) return std::unexpected(block.error());
+
+        uint32_t payload_size = static_cast<uint32_t>(block->payload.size());
+        out.write(reinterpret_cast<const char*>(&front.raw_size), sizeof(front.raw_size));
+        out.write(reinterpret_cast<const char*>(&payload_size), sizeof(payload_size));
+        index.push_back({ static_cast<uint64_t>(out.tellp()), payload_size, front.raw_size });
+        out.write(reinterpret_cast<const char*>(block->payload.data()), payload_size);
+        if (!out) return std::unexpected(HuffmanError::FileWriteError);
+        meta_size += sizeof(front.raw_size) + sizeof(payload_size) + block->metadata_size;
+        return {};
+    };
+
+    while (true) {
+        std::vector<uint8_t> data(block_size);
+        in.read(reinterpret_cast<char*>(data.data()), block_size);
+        const auto got = static_cast<uint32_t>(in.gcount());
+        if (got == 0) break;
+        data.resize(got);
+
+        pending.push_back({ got, pool.Submit([data = std::move(data), max_code_length, four_streams] {
+            return EncodeBlock(data, max_code_length, four_streams);
+        }) });
+
+        if (pending.size() >= max_in_flight) {
+            if (auto res = write_front(); !res) return std::unexpected(res.error());
+        }
+    }
+    while (!pending.empty()) {
+        if (auto res = write_front(); !res) return std::unexpected(res.error());
+    }
+
+    const uint32_t terminator = 0;
+    out.write(reinterpret_cast<const char*>(&terminator), sizeof(terminator));
 
-    current_path.push_back(true);
-    BuildCodes(node->right, current_path, codes);
-    current_path.pop_back();
+    for (const auto& entry : index) {
+        out.write(reinterpret_cast<const char*>(&entry.offset), sizeof(entry.offset));
+        out.write(reinterpret_cast<const char*>(&entry.payload_size), sizeof(entry.payload_size));
+        out.write(reinterpret_cast<const char*>(&entry.raw_size), sizeof(entry.raw_size));
+    }
+    const uint64_t block_count = index.size();
+    out.write(reinterpret_cast<const char*>(&block_count), sizeof(block_count));
+    if (!out) return std::unexpected(HuffmanError::FileWriteError);
+    return meta_size + sizeof(terminator) + index.size() * INDEX_ENTRY_SIZE + sizeof(block_count);
+}
+
+std::expected<std::vector<HuffmanCoder::BlockIndexEntry>, HuffmanError> HuffmanCoder::ReadBlockIndex(
+    std::span<const uint8_t> archive, size_t payload_offset, uint32_t block_size)
+{
+    uint64_t block_count = 0;
+    if (archive.size() < payload_offset + sizeof(block_count)) return std::unexpected(HuffmanError::InvalidFormat);
+    std::memcpy(&block_count, archive.data() + archive.size() - sizeof(block_count), sizeof(block_count));
+
+    const size_t trailer_space = archive.size() - payload_offset - sizeof(block_count);
+    if (block_count > trailer_space / INDEX_ENTRY_SIZE) return std::unexpected(HuffmanError::InvalidFormat);
+    const size_t index_offset = archive.size() - sizeof(block_count) - static_cast<size_t>(block_count) * INDEX_ENTRY_SIZE;
+
+    std::vector<BlockIndexEntry> index(static_cast<size_t>(block_count));
+    const uint8_t* p = archive.data() + index_offset;
+    for (auto& entry : index) {
+        std::memcpy(&entry.offset, p, sizeof(entry.offset));
+        std::memcpy(&entry.payload_size, p + 8, sizeof(entry.payload_size));
+        std::memcpy(&entry.raw_size, p + 12, sizeof(entry.raw_size));
+        p += INDEX_ENTRY_SIZE;
+
+        if (entry.raw_size == 0 || entry.raw_size > block_size ||
+            entry.offset < payload_offset || entry.offset > index_offset ||
+            entry.payload_size > index_offset - entry.offset)
+            return std::unexpected(HuffmanError::InvalidFormat);
+    }
+    return index;
+}
+
+std::expected<void, HuffmanError> HuffmanCoder::DecompressIndexedBlocks(
+    std::span<const uint8_t> archive, const std::vector<BlockIndexEntry>& index,
+    const std::filesystem::path& out_path, unsigned threads)
+{
+    uint64_t total_size = 0;
+    for (const auto& entry : index) total_size += entry.raw_size;
+    if (total_size > std::numeric_limits<size_t>::max()) return std::unexpected(HuffmanError::FileWriteError);
+
+    // Недописаний вихід видаляється після відображення; при успіху шлях скидається.
+    TempFile partial{ out_path };
+    auto out_file = MappedFile::Create(out_path, static_cast<size_t>(total_size));
+    if (!out_file) return std::unexpected(HuffmanError::FileWriteError);
+    std::span<uint8_t> out = out_file->MutableData();
+
+    ThreadPool pool(ThreadPool::WorkerCount(threads, index.size()));
+    std::vector<std::future<std::expected<void, HuffmanError>>> results;
+    results.reserve(index.size());
+
+    size_t out_offset = 0;
+    for (const auto& entry : index) {
+        auto payload = archive.subspan(static_cast<size_t>(entry.offset), entry.payload_size);
+        auto block = out.subspan(out_offset, entry.raw_size);
+        results.push_back(pool.Submit([payload, block] { return DecodeBlock(payload, block); }));
+        out_offset += entry.raw_size;
+    }
+
+    std::expected<void, HuffmanError> status;
+    for (auto& result : results) {
+        auto res = result.get();
+        if (!res && status) status = res;
+    }
+    if (status) partial.path.clear();
+    return status;
 }
 
 std::expected<std::string, HuffmanError> HuffmanCoder::ExtractOriginalFilename(const std::filesystem::path& in_path) {
@@ -63,16 +342,23 @@ std::expected<std::string, HuffmanError> HuffmanCoder::ExtractOriginalFilename(c
 
 std::expected<HuffmanStats, HuffmanError> HuffmanCoder::Compress(
     const std::filesystem::path& in_path, std::filesystem::path out_path,
-    bool use_bwt, bool use_mtf)
+    bool use_bwt, bool use_mtf, uint8_t max_code_length, bool four_streams,
+    uint32_t block_size, unsigned threads, uint32_t bwt_block_size, size_t bwt_memory, uint8_t bwt_chains, bool use_zero_runs)
 {
+    if (max_code_length < HuffmanCodeBuilder::MIN_LENGTH_LIMIT || max_code_length > HuffmanCodeBuilder::MAX_LENGTH_LIMIT)
+        return std::unexpected(HuffmanError::InvalidCodeLength);
+    if (block_size > MAX_BLOCK_SIZE) return std::unexpected(HuffmanError::InvalidBlockSize);
+    if ((use_bwt || use_mtf || use_zero_runs) && !TransformSplitting::ValidateBlockSize(bwt_block_size, bwt_memory))
+        return std::unexpected(HuffmanError::InvalidBwtBlockSize);
+    if (bwt_chains > TransformSplitting::MAX_BWT_CHAINS) return std::unexpected(HuffmanError::InvalidBwtChains);
     if (out_path.empty()) out_path = in_path.string() + ".huff";
 
     std::filesystem::path data_to_compress = in_path;
     TempFile temp_;
 
-    if (use_bwt || use_mtf) {
+    if (use_bwt || use_mtf || use_zero_runs) {
         auto temp_file = std::filesystem::temp_directory_path() / (in_path.filename().string() + ".huff.tmp");
-        if (!TransformSplitting::ApplyForward(in_path, temp_file, use_bwt, use_mtf))
+        if (!TransformSplitting::ApplyForward(in_path, temp_file, use_bwt, use_mtf, threads, bwt_block_size, bwt_memory, bwt_chains, use_zero_runs))
             return std::unexpected(HuffmanError::TransformFailed);
         data_to_compress = temp_file;
         temp_.path = temp_file;
@@ -81,19 +367,50 @@ std::expected<HuffmanStats, HuffmanError> HuffmanCoder::Compress(
     std::ifstream in(data_to_compress, std::ios::binary);
     if (!in) return std::unexpected(HuffmanError::FileNotFound);
 
-    std::array<uint32_t, 256> freqs = { 0 };
+    if (block_size > 0) {
+        std::error_code ec;
+        const uintmax_t data_size = std::filesystem::file_size(data_to_compress, ec);
+        if (data_size == 0 || ec)
+            return std::unexpected(HuffmanError::EmptyFile);
+
+        std::ofstream out(out_path, std::ios::binary);
+        if (!out) return std::unexpected(HuffmanError::FileWriteError);
+
+        std::string orig_name = in_path.filename().string();
+        if (orig_name.length() > 255) orig_name = orig_name.substr(0, 255);
+        uint8_t name_len = static_cast<uint8_t>(orig_name.length());
+        out.write(reinterpret_cast<const char*>(&name_len), 1);
+        out.write(orig_name.data(), name_len);
+
+        uint8_t transform_flags = (use_bwt ? FLAG_BWT : 0) | (use_mtf ? FLAG_MTF : 0) | (use_zero_runs ? FLAG_ZERO_RUNS : 0)
+            | FLAG_CANONICAL | FLAG_BLOCKS | FLAG_BLOCK_INDEX;
+        out.write(reinterpret_cast<const char*>(&transform_flags), 1);
+        out.write(reinterpret_cast<const char*>(&block_size), sizeof(block_size));
+        uintmax_t meta_size = 1 + name_len + 1 + sizeof(block_size);
+
+        const unsigned workers = ThreadPool::WorkerCount(threads, (data_size + block_size - 1) / block_size);
+        auto blocks_meta = CompressBlocks(in, out, block_size, max_code_length, four_streams, workers);
+        if (!blocks_meta) return std::unexpected(blocks_meta.error());
+        meta_size += *blocks_meta;
+        out.close();
+
+        HuffmanStats stats;
+        stats.original_size = std::filesystem::file_size(in_path);
+        stats.compressed_size = std::filesystem::file_size(out_path);
+        stats.metadata_size = meta_size;
+        return stats;
+    }
+
+    std::array<uint64_t, 256> freqs = { 0 };
     std::vector<char> buf(2048 * 1024);
-    uint32_t total_bytes = 0;
-    uint32_t unique_count = 0;
+    uint64_t total_bytes = 0;
 
     while (in.read(buf.data(), buf.size()) || in.gcount() > 0) {
-        for (int i = 0; i < in.gcount(); ++i) {
-            uint8_t c = static_cast<uint8_t>(buf[i]);
-            if (freqs[c] == 0) unique_count++;
-            freqs[c]++;
-            total_bytes++;
-        }
+        std::span<const uint8_t> chunk(reinterpret_cast<const uint8_t*>(buf.data()), static_cast<size_t>(in.gcount()));
+        Histogram::Accumulate(chunk, freqs);
+        total_bytes += chunk.size();
     }
+    const uint32_t unique_count = Histogram::UniqueSymbols(freqs);
 
     if (total_bytes == 0) return std::unexpected(HuffmanError::EmptyFile);
 
@@ -107,60 +424,55 @@ std::expected<HuffmanStats, HuffmanError> HuffmanCoder::Compress(
     out.write(orig_name.data(), name_len);
 
     bool is_single_symbol = (unique_count == 1);
-    uint8_t transform_flags = (use_bwt ? 1 : 0) | (use_mtf ? 2 : 0) | (is_single_symbol ? 4 : 0);
+    uint8_t transform_flags = (use_bwt ? FLAG_BWT : 0) | (use_mtf ? FLAG_MTF : 0) | (use_zero_runs ? FLAG_ZERO_RUNS : 0)
+        | (is_single_symbol ? FLAG_SINGLE_SYMBOL : 0) | FLAG_CANONICAL
+        | (four_streams && !is_single_symbol ? FLAG_FOUR_STREAMS : 0);
     out.write(reinterpret_cast<const char*>(&transform_flags), 1);
 
-    uintmax_t meta_size = 1 + name_len + 1 + 32;
+    auto lengths = HuffmanCodeBuilder::BuildLengths(freqs, max_code_length);
 
-    uint8_t bitmask[32] = { 0 };
-    for (int i = 0; i < 256; ++i)
-        if (freqs[i] > 0) bitmask[i / 8] |= (1 << (i % 8));
-    out.write(reinterpret_cast<char*>(bitmask), 32);
+    auto packed_lengths = HuffmanCodeBuilder::PackLengths(lengths);
 
-    for (int i = 0; i < 256; ++i) {
-        if (freqs[i] > 0) {
-            out.write(reinterpret_cast<char*>(&freqs[i]), sizeof(uint32_t));
-            meta_size += sizeof(uint32_t);
-        }
-    }
+    out.write(reinterpret_cast<const char*>(&total_bytes), sizeof(total_bytes));
+    out.write(reinterpret_cast<const char*>(packed_lengths.data()), packed_lengths.size());
+    uintmax_t meta_size = 1 + name_len + 1 + sizeof(total_bytes) + packed_lengths.size();
 
     if (!is_single_symbol) {
-        std::vector<std::unique_ptr<Node>> arena;
-        std::priority_queue<Node*, std::vector<Node*>, CompareNode> pq;
-
-        for (int i = 0; i < 256; ++i) {
-            if (freqs[i] > 0) {
-                arena.push_back(std::make_unique<Node>(static_cast<uint8_t>(i), freqs[i]));
-                pq.push(arena.back().get());
-            }
-        }
-
-        while (pq.size() > 1) {
-            auto left = pq.top(); pq.pop();
-            auto right = pq.top(); pq.pop();
-            arena.push_back(std::make_unique<Node>(0, left->freq + right->freq));
-            auto parent = arena.back().get();
-            parent->left = left;
-            parent->right = right;
-            pq.push(parent);
-        }
-
+        auto canonical = HuffmanCodeBuilder::BuildCanonicalCodes(lengths);
         std::array<Code, 256> codes;
-        std::vector<bool> path;
-        BuildCodes(pq.top(), path, codes);
+        for (int i = 0; i < 256; ++i)
+            codes[i] = { static_cast<uint32_t>(canonical[i]), lengths[i] };
 
-        BitWriter bw(out);
         in.clear();
         in.seekg(0);
-        while (in.read(buf.data(), buf.size()) || in.gcount() > 0) {
-            for (int i = 0; i < in.gcount(); ++i) {
-                const auto& code = codes[static_cast<uint8_t>(buf[i])];
-                if (code.bit_length > 0) {
-                    if (!bw.WriteBitSequence(code.data, code.bit_length))
-                        return std::unexpected(HuffmanError::FileWriteError);
+
+        if (four_streams) {
+            std::array<std::vector<uint8_t>, 4> stream_data;
+            {
+                BitWriter w0(stream_data[0]), w1(stream_data[1]), w2(stream_data[2]), w3(stream_data[3]);
+                std::array<BitWriter*, 4> writers = { &w0, &w1, &w2, &w3 };
+                while (in.read(buf.data(), buf.size()) || in.gcount() > 0) {
+                    std::span<const uint8_t> chunk(reinterpret_cast<const uint8_t*>(buf.data()), static_cast<size_t>(in.gcount()));
+                    if (!EncodeStreams(chunk, codes, writers)) return std::unexpected(HuffmanError::FileWriteError);
                 }
             }
+
+            for (int k = 0; k < 3; ++k) {
+                uint64_t size = stream_data[k].size();
+                out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+            }
+            meta_size += 3 * sizeof(uint64_t);
+            for (const auto& data : stream_data)
+                out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        }
+        else {
+            BitWriter bw(out);
+            while (in.read(buf.data(), buf.size()) || in.gcount() > 0) {
+                std::span<const uint8_t> chunk(reinterpret_cast<const uint8_t*>(buf.data()), static_cast<size_t>(in.gcount()));
+                if (!EncodeStream(chunk, codes, bw)) return std::unexpected(HuffmanError::FileWriteError);
+            }
         }
+        if (!out) return std::unexpected(HuffmanError::FileWriteError);
     }
 
     out.close();
@@ -173,7 +485,7 @@ std::expected<HuffmanStats, HuffmanError> HuffmanCoder::Compress(
 }
 
 std::expected<void, HuffmanError> HuffmanCoder::Decompress(
-    const std::filesystem::path& in_path, std::filesystem::path out_path)
+    const std::filesystem::path& in_path, std::filesystem::path out_path, unsigned threads, size_t bwt_memory)
 {
     std::ifstream in(in_path, std::ios::binary);
     if (!in) return std::unexpected(HuffmanError::FileNotFound);
@@ -185,99 +497,185 @@ std::expected<void, HuffmanError> HuffmanCoder::Decompress(
     uint8_t transform_flags = 0;
     if (!in.read(reinterpret_cast<char*>(&transform_flags), 1)) return std::unexpected(HuffmanError::InvalidFormat);
 
-    bool use_bwt = (transform_flags & 1) != 0;
-    bool use_mtf = (transform_flags & 2) != 0;
-    bool is_single_symbol = (transform_flags & 4) != 0;
-
-    uint8_t bitmask[32];
-    if (!in.read(reinterpret_cast<char*>(bitmask), 32)) return std::unexpected(HuffmanError::InvalidFormat);
+    bool use_bwt = (transform_flags & FLAG_BWT) != 0;
+    bool use_mtf = (transform_flags & FLAG_MTF) != 0;
+    bool use_zero_runs = (transform_flags & FLAG_ZERO_RUNS) != 0;
+    bool is_single_symbol = (transform_flags & FLAG_SINGLE_SYMBOL) != 0;
+    bool is_canonical = (transform_flags & FLAG_CANONICAL) != 0;
+    bool four_streams = (transform_flags & FLAG_FOUR_STREAMS) != 0;
+    bool is_blocks = (transform_flags & FLAG_BLOCKS) != 0;
+    bool has_index = (transform_flags & FLAG_BLOCK_INDEX) != 0;
 
     std::array<uint32_t, 256> freqs = { 0 };
-    uint32_t total_bytes = 0;
+    std::array<uint8_t, 256> lengths = { 0 };
+    uint64_t total_bytes = 0;
     uint32_t unique_count = 0;
     uint8_t  the_only_symbol = 0;
+    uint32_t block_size = 0;
+
+    if (is_blocks) {
+        if (!is_canonical || is_single_symbol || four_streams)
+            return std::unexpected(HuffmanError::InvalidFormat);
+        if (!in.read(reinterpret_cast<char*>(&block_size), sizeof(block_size)) || block_size == 0 || block_size > MAX_BLOCK_SIZE)
+            return std::unexpected(HuffmanError::InvalidFormat);
+    }
+    else if (is_canonical) {
+        std::array<uint8_t, 128> packed_lengths;
+        if (!in.read(reinterpret_cast<char*>(&total_bytes), sizeof(total_bytes)) ||
+            !in.read(reinterpret_cast<char*>(packed_lengths.data()), packed_lengths.size()))
+            return std::unexpected(HuffmanError::InvalidFormat);
 
-    for (int i = 0; i < 256; ++i) {
-        if (bitmask[i / 8] & (1 << (i % 8))) {
-            if (!in.read(reinterpret_cast<char*>(&freqs[i]), sizeof(uint32_t)))
-                return std::unexpected(HuffmanError::InvalidFormat);
-            total_bytes += freqs[i];
-            unique_count++;
-            the_only_symbol = static_cast<uint8_t>(i);
+        lengths = HuffmanCodeBuilder::UnpackLengths(packed_lengths);
+        for (int i = 0; i < 256; ++i) {
+            if (lengths[i] > 0) {
+                unique_count++;
+                the_only_symbol = static_cast<uint8_t>(i);
+            }
         }
+        if (!is_single_symbol && !HuffmanCodeBuilder::IsComplete(lengths, HuffmanCodeBuilder::MAX_LENGTH_LIMIT))
+            return std::unexpected(HuffmanError::InvalidFormat);
     }
+    else {
+        uint8_t bitmask[32];
+        if (!in.read(reinterpret_cast<char*>(bitmask), 32)) return std::unexpected(HuffmanError::InvalidFormat);
 
-    if (total_bytes == 0) return std::unexpected(HuffmanError::EmptyFile);
+        for (int i = 0; i < 256; ++i) {
+            if (bitmask[i / 8] & (1 << (i % 8))) {
+                if (!in.read(reinterpret_cast<char*>(&freqs[i]), sizeof(uint32_t)))
+                    return std::unexpected(HuffmanError::InvalidFormat);
+                total_bytes += freqs[i];
+                unique_count++;
+                the_only_symbol = static_cast<uint8_t>(i);
+            }
+        }
+    }
+
+    if (total_bytes == 0 && !is_blocks) return std::unexpected(HuffmanError::EmptyFile);
 
     if (is_single_symbol && unique_count != 1)
         return std::unexpected(HuffmanError::InvalidFormat);
 
+    if (four_streams && (!is_canonical || is_single_symbol))
+        return std::unexpected(HuffmanError::InvalidFormat);
+
+    // Блоковий архів завжди має індекс блоків.
+    if (has_index != is_blocks)
+        return std::unexpected(HuffmanError::InvalidFormat);
+
+    std::array<uint64_t, 3> stream_sizes = { 0, 0, 0 };
+    if (four_streams && !in.read(reinterpret_cast<char*>(stream_sizes.data()), sizeof(stream_sizes)))
+        return std::unexpected(HuffmanError::InvalidFormat);
+
+    const auto payload_offset = static_cast<size_t>(in.tellg());
+    in.close();
+
+    auto mapped = MappedFile::Open(in_path);
+    if (!mapped) return std::unexpected(HuffmanError::FileReadError);
+    if (payload_offset > mapped->Data().size()) return std::unexpected(HuffmanError::InvalidFormat);
+
     std::filesystem::path extracted_data_path = out_path;
     TempFile temp_;
 
-    if (use_bwt || use_mtf) {
+    if (use_bwt || use_mtf || use_zero_runs) {
         auto temp_file = std::filesystem::temp_directory_path() / (out_path.filename().string() + ".huff.tmp");
         extracted_data_path = temp_file;
         temp_.path = temp_file;
     }
 
-    std::ofstream out(extracted_data_path, std::ios::binary);
-    if (!out) return std::unexpected(HuffmanError::FileWriteError);
+    std::ofstream out;
+    if (!has_index) {
+        out.open(extracted_data_path, std::ios::binary);
+        if (!out) return std::unexpected(HuffmanError::FileWriteError);
+    }
 
-    if (is_single_symbol) {
+    if (has_index) {
+        auto index = ReadBlockIndex(mapped->Data(), payload_offset, block_size);
+        if (!index) return std::unexpected(index.error());
+        if (auto res = DecompressIndexedBlocks(mapped->Data(), *index, extracted_data_path, threads); !res) return res;
+    }
+    else if (is_single_symbol) {
         constexpr uint32_t CHUNK = 65536;
         std::vector<char> chunk_buf(CHUNK, static_cast<char>(the_only_symbol));
-        uint32_t remaining = total_bytes;
+        uint64_t remaining = total_bytes;
         while (remaining > 0) {
-            uint32_t n = std::min(remaining, CHUNK);
+            uint32_t n = static_cast<uint32_t>(std::min<uint64_t>(remaining, CHUNK));
             out.write(chunk_buf.data(), n);
             remaining -= n;
         }
     }
     else {
-        std::vector<std::unique_ptr<Node>> arena;
-        std::priority_queue<Node*, std::vector<Node*>, CompareNode> pq;
+        std::array<uint64_t, 256> table_codes = { 0 };
+        std::array<uint8_t, 256> table_lengths = { 0 };
 
-        for (int i = 0; i < 256; ++i) {
-            if (freqs[i] > 0) {
-                arena.push_back(std::make_unique<Node>(static_cast<uint8_t>(i), freqs[i]));
-                pq.push(arena.back().get());
-            }
+        if (is_canonical) {
+            table_codes = HuffmanCodeBuilder::BuildCanonicalCodes(lengths);
+            table_lengths = lengths;
         }
+        else {
+            std::vector<std::unique_ptr<Node>> arena;
+            std::priority_queue<Node*, std::vector<Node*>, CompareNode> pq;
+
+            for (int i = 0; i < 256; ++i) {
+                if (freqs[i] > 0) {
+                    arena.push_back(std::make_unique<Node>(static_cast<uint8_t>(i), freqs[i]));
+                    pq.push(arena.back().get());
+                }
+            }
 
-        while (pq.size() > 1) {
-            auto left = pq.top(); pq.pop();
-            auto right = pq.top(); pq.pop();
-            arena.push_back(std::make_unique<Node>(0, left->freq + right->freq));
-            auto parent = arena.back().get();
-            parent->left = left;
-            parent->right = right;
-            pq.push(parent);
+            while (pq.size() > 1) {
+                auto left = pq.top(); pq.pop();
+                auto right = pq.top(); pq.pop();
+                arena.push_back(std::make_unique<Node>(0, left->freq + right->freq));
+                auto parent = arena.back().get();
+                parent->left = left;
+                parent->right = right;
+                pq.push(parent);
+            }
+
+            BuildCodes(pq.top(), 0, 0, table_codes, table_lengths);
         }
 
-        Node* root = pq.top();
-        BitReader br(in);
-        uint32_t decoded_bytes = 0;
-        std::vector<uint8_t> bit(1);
-
-        while (decoded_bytes < total_bytes) {
-            Node* curr = root;
-            while (!curr->is_leaf()) {
-                auto res = br.ReadBitSequence(bit, 1);
-                if (!res) return std::unexpected(HuffmanError::InvalidFormat);
-                if (bit[0] & 1) curr = curr->right;
-                else            curr = curr->left;
-                bit[0] = 0;
+        HuffmanDecodeTable table;
+        if (!table.Build(table_codes, table_lengths)) return std::unexpected(HuffmanError::InvalidFormat);
+
+        std::span<const uint8_t> payload = mapped->Data().subspan(payload_offset);
+        std::vector<uint8_t> out_buf(1024 * 1024);
+        uint64_t remaining = total_bytes;
+
+        if (four_streams) {
+            std::array<std::span<const uint8_t>, 4> parts;
+            for (int k = 0; k < 3; ++k) {
+                if (stream_sizes[k] > payload.size()) return std::unexpected(HuffmanError::InvalidFormat);
+                parts[k] = payload.first(static_cast<size_t>(stream_sizes[k]));
+                payload = payload.subspan(static_cast<size_t>(stream_sizes[k]));
+            }
+            parts[3] = payload;
+
+            BitReader streams[4] = { BitReader(parts[0]), BitReader(parts[1]), BitReader(parts[2]), BitReader(parts[3]) };
+            while (remaining > 0) {
+                size_t n = static_cast<size_t>(std::min<uint64_t>(remaining, out_buf.size()));
+                if (!table.Decode(streams, std::span<uint8_t>(out_buf.data(), n)))
+                    return std::unexpected(HuffmanError::InvalidFormat);
+                out.write(reinterpret_cast<const char*>(out_buf.data()), n);
+                remaining -= n;
+            }
+        }
+        else {
+            BitReader br(payload);
+            while (remaining > 0) {
+                size_t n = static_cast<size_t>(std::min<uint64_t>(remaining, out_buf.size()));
+                if (!table.Decode(br, std::span<uint8_t>(out_buf.data(), n)))
+                    return std::unexpected(HuffmanError::InvalidFormat);
+                out.write(reinterpret_cast<const char*>(out_buf.data()), n);
+                remaining -= n;
             }
-            out.put(static_cast<char>(curr->symbol));
-            decoded_bytes++;
         }
     }
 
-    out.close();
+    if (out.is_open()) out.close();
 
     if (!temp_.path.empty()) {
-        if (!TransformSplitting::ApplyReverse(temp_.path, out_path, use_bwt, use_mtf))
+        if (!TransformSplitting::ApplyReverse(temp_.path, out_path, use_bwt, use_mtf, threads, bwt_memory, use_zero_runs))
             return std::unexpected(HuffmanError::TransformFailed);
     }
 
@@ -8,6 +8,8 @@
 #include <string_view>
 #include <filesystem>
 #include <memory>
+#include <span>
+#include "../BitStream/BitStream.hpp"
 
 struct HuffmanStats {
     uintmax_t original_size;
@@ -24,7 +26,13 @@ enum class HuffmanError {
     FileSameAsInput,
     EmptyFile,
 	NoPathProvided,
-    TransformFailed 
+    TransformFailed,
+    InvalidCodeLength,
+    InvalidBlockSize,
+    InvalidBwtBlockSize,
+    InvalidBwtMemory,
+    InvalidBwtChains,
+    InvalidThreadCount
 };
 
 std::string_view HuffmanError_to_string(HuffmanError err);
@@ -35,16 +43,39 @@ public:
         const std::filesystem::path& in_path,
         std::filesystem::path out_path = "",
         bool use_bwt = false,
-        bool use_mtf = false);
+        bool use_mtf = false,
+        uint8_t max_code_length = 15,
+        bool four_streams = false,
+        uint32_t block_size = 0,
+        unsigned threads = 0,
+        uint32_t bwt_block_size = 0,
+        size_t bwt_memory = 0,
+        uint8_t bwt_chains = 1,
+        bool use_zero_runs = false);
 
     static std::expected<void, HuffmanError> Decompress(
         const std::filesystem::path& in_path,
-        std::filesystem::path out_path);
+        std::filesystem::path out_path,
+        unsigned threads = 0,
+        size_t bwt_memory = 0);
 
     static std::expected<std::string, HuffmanError> ExtractOriginalFilename(
         const std::filesystem::path& in_path);
 
 private:
+    static constexpr uint8_t FLAG_BWT = 1;
+    static constexpr uint8_t FLAG_MTF = 2;
+    static constexpr uint8_t FLAG_SINGLE_SYMBOL = 4;
+    static constexpr uint8_t FLAG_CANONICAL = 8;
+    static constexpr uint8_t FLAG_FOUR_STREAMS = 16;
+    static constexpr uint8_t FLAG_BLOCKS = 32;
+    static constexpr uint8_t FLAG_BLOCK_INDEX = 64;
+    static constexpr uint8_t FLAG_ZERO_RUNS = 128;
+
+    static constexpr uint8_t BLOCK_SINGLE_SYMBOL = 1;
+    static constexpr uint8_t BLOCK_FOUR_STREAMS = 2;
+    static constexpr uint32_t MAX_BLOCK_SIZE = 256u * 1024 * 1024;
+
     struct Node {
         uint8_t symbol = 0;
         uint32_t freq = 0;
@@ -61,10 +92,40 @@ private:
     };
 
     struct Code {
-        std::vector<uint8_t> data;
-        size_t bit_length = 0;
+        uint32_t bits = 0;
+        uint8_t len = 0;
+    };
+
+    static std::expected<void, BitStreamError> EncodeStream(
+        std::span<const uint8_t> data, const std::array<Code, 256>& codes, BitWriter& bw);
+    static std::expected<void, BitStreamError> EncodeStreams(
+        std::span<const uint8_t> data, const std::array<Code, 256>& codes, std::span<BitWriter* const, 4> streams);
+
+    struct BlockIndexEntry {
+        uint64_t offset = 0;
+        uint32_t payload_size = 0;
+        uint32_t raw_size = 0;
+    };
+    static constexpr size_t INDEX_ENTRY_SIZE = sizeof(uint64_t) + 2 * sizeof(uint32_t);
+
+    struct EncodedBlock {
+        std::vector<uint8_t> payload;
+        uintmax_t metadata_size = 0;
     };
 
-    static void BuildCodes(Node* node, std::vector<bool>& current_path, std::array<Code, 256>& codes);
-    static std::vector<uint8_t> PackBits(const std::vector<bool>& bits);
+    static std::expected<EncodedBlock, HuffmanError> EncodeBlock(
+        std::span<const uint8_t> data, uint8_t max_code_length, bool four_streams);
+    static std::expected<void, HuffmanError> DecodeBlock(
+        std::span<const uint8_t> payload, std::span<uint8_t> out);
+    static std::expected<uintmax_t, HuffmanError> CompressBlocks(
+        std::istream& in, std::ostream& out, uint32_t block_size,
+        uint8_t max_code_length, bool four_streams, unsigned threads);
+    static std::expected<std::vector<BlockIndexEntry>, HuffmanError> ReadBlockIndex(
+        std::span<const uint8_t> archive, size_t payload_offset, uint32_t block_size);
+    static std::expected<void, HuffmanError> DecompressIndexedBlocks(
+        std::span<const uint8_t> archive, const std::vector<BlockIndexEntry>& index,
+        const std::filesystem::path& out_path, unsigned threads);
+
+    static void BuildCodes(const Node* node, uint64_t path, unsigned depth,
+        std::array<uint64_t, 256>& codes, std::array<uint8_t, 256>& lengths);
 };
\ No newline at end of file
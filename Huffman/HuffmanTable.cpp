@@ -0,0 +1,244 @@
+﻿#include "HuffmanTable.hpp"
+#include <algorithm>
+
+std::array<uint8_t, 256> HuffmanCodeBuilder::BuildLengths(const std::array<uint64_t, 256>& freqs, unsigned max_length) {
+    std::array<uint8_t, 256> lengths = { 0 };
+    std::array<uint8_t, 256> symbols;
+    std::array<uint64_t, 256> a;
+    int n = 0;
+    for (int s = 0; s < 256; ++s)
+        if (freqs[s] > 0) symbols[n++] = static_cast<uint8_t>(s);
+
+    if (n == 0) return lengths;
+    if (n == 1) {
+        lengths[symbols[0]] = 1;
+        return lengths;
+    }
+
+    std::sort(symbols.begin(), symbols.begin() + n, [&](uint8_t x, uint8_t y) {
+        return freqs[x] != freqs[y] ? freqs[x] < freqs[y] : x < y;
+        });
+    for (int i = 0; i < n; ++i) a[i] = freqs[symbols[i]];
+
+    // Moffat & Katajainen: довжини кодів на місці, без побудови дерева.
+    a[0] += a[1];
+    int root = 0, leaf = 2;
+    for (int next = 1; next < n - 1; ++next) {
+        if (leaf >= n || a[root] < a[leaf]) { a[next] = a[root]; a[root++] = next; }
+        else a[next] = a[leaf++];
+        if (leaf >= n || (root < next && a[root] < a[leaf])) { a[next] += a[root]; a[root++] = next; }
+        else a[next] += a[leaf++];
+    }
+    a[n - 2] = 0;
+    for (int next = n - 3; next >= 0; --next) a[next] = a[a[next]] + 1;
+
+    // До обмеження довжин глибина дерева сягає n - 1 <= 255 (за сильно нерівних 64-бітних частот це більше 63),
+    // тож гістограма глибин покриває всі можливі глибини.
+    std::array<uint32_t, 256> count = { 0 };
+    {
+        int avbl = 1, used = 0, dpth = 0;
+        root = n - 2;
+        int next = n - 1;
+        while (avbl > 0) {
+            while (root >= 0 && static_cast<int>(a[root]) == dpth) { used++; root--; }
+            while (avbl > used) { count[dpth]++; next--; avbl--; }
+            avbl = 2 * used; dpth++; used = 0;
+        }
+    }
+
+    for (unsigned len = max_length + 1; len < count.size(); ++len) {
+        count[max_length] += count[len];
+        count[len] = 0;
+    }
+    uint64_t total = 0;
+    for (unsigned len = 1; len <= max_length; ++len)
+        total += static_cast<uint64_t>(count[len]) << (max_length - len);
+    while (total > (1ULL << max_length)) {
+        count[max_length]--;
+        for (unsigned len = max_length - 1; len > 0; --len) {
+            if (count[len]) {
+                count[len]--;
+                count[len + 1] += 2;
+                break;
+            }
+        }
+        total--;
+    }
+
+    int j = n;
+    for (unsigned len = 1; len <= max_length; ++len)
+        for (uint32_t k = 0; k < count[len]; ++k)
+            lengths[symbols[--j]] = static_cast<uint8_t>(len);
+    return lengths;
+}
+
+std::array<uint64_t, 256> HuffmanCodeBuilder::BuildCanonicalCodes(const std::array<uint8_t, 256>& lengths) {
+    std::array<uint32_t, 64> count = { 0 };
+    for (uint8_t len : lengths) count[len]++;
+    count[0] = 0;
+
+    std::array<uint64_t, 64> next_code = { 0 };
+    uint64_t code = 0;
+    for (size_t len = 1; len < count.size(); ++len) {
+        code = (code + count[len - 1]) << 1;
+        next_code[len] = code;
+    }
+
+    std::array<uint64_t, 256> codes = { 0 };
+    for (int s = 0; s < 256; ++s) {
+        unsigned len = lengths[s];
+        if (len == 0) continue;
+        uint64_t c = next_code[len]++;
+        uint64_t reversed = 0;
+        for (unsigned b = 0; b < len; ++b)
+            reversed |= ((c >> b) & 1) << (len - 1 - b);
+        codes[s] = reversed;
+    }
+    return codes;
+}
+
+bool HuffmanCodeBuilder::IsComplete(const std::array<uint8_t, 256>& lengths, unsigned max_length) {
+    uint64_t total = 0;
+    for (uint8_t len : lengths) {
+        if (len > max_length) return false;
+        if (len > 0) total += 1ULL << (max_length - len);
+    }
+    return total == (1ULL << max_length);
+}
+
+std::array<uint8_t, 128> HuffmanCodeBuilder::PackLengths(const std::array<uint8_t, 256>& lengths) {
+    std::array<uint8_t, 128> packed = { 0 };
+    for (int i = 0; i < 256; ++i)
+        packed[i / 2] |= static_cast<uint8_t>((lengths[i] & 0x0F) << ((i % 2) * 4));
+    return packed;
+}
+
+std::array<uint8_t, 256> HuffmanCodeBuilder::UnpackLengths(std::span<const uint8_t, 128> packed) {
+    std::array<uint8_t, 256> lengths;
+    for (int i = 0; i < 256; ++i)
+        lengths[i] = (packed[i / 2] >> ((i % 2) * 4)) & 0x0F;
+    return lengths;
+}
+
+std::expected<void, HuffmanError> HuffmanDecodeTable::Build(
+    const std::array<uint64_t, 256>& codes,
+    const std::array<uint8_t, 256>& lengths)
+{
+    std::vector<Item> items;
+    max_length_ = 0;
+    for (int s = 0; s < 256; ++s) {
+        if (lengths[s] == 0) continue;
+        if (lengths[s] > MAX_CODE_LENGTH) return std::unexpected(HuffmanError::InvalidFormat);
+        items.push_back({ codes[s], lengths[s], static_cast<uint8_t>(s) });
+        max_length_ = std::max<unsigned>(max_length_, lengths[s]);
+    }
+    if (items.empty()) return std::unexpected(HuffmanError::InvalidFormat);
+
+    table_.clear();
+    auto res = BuildLevel(items, 0, PRIMARY_BITS);
+    if (!res) return std::unexpected(res.error());
+    return {};
+}
+
+std::expected<size_t, HuffmanError> HuffmanDecodeTable::BuildLevel(std::span<Item> items, unsigned depth, unsigned bits) {
+    const size_t base = table_.size();
+    const uint32_t size = 1u << bits;
+    table_.resize(base + size, 0);
+
+    auto key_of = [&](const Item& it) {
+        return static_cast<uint32_t>((it.code >> depth) & (size - 1));
+    };
+
+    for (const Item& it : items) {
+        unsigned rest = it.length - depth;
+        if (rest > bits) continue;
+        uint32_t entry = (static_cast<uint32_t>(it.symbol) << 8) | it.length;
+        for (uint32_t idx = key_of(it) & ((1u << rest) - 1); idx < size; idx += (1u << rest)) {
+            if (table_[base + idx] != 0) return std::unexpected(HuffmanError::InvalidFormat);
+            table_[base + idx] = entry;
+        }
+    }
+
+    auto long_end = std::partition(items.begin(), items.end(),
+        [&](const Item& it) { return it.length - depth > bits; });
+    std::span<Item> long_items(items.begin(), long_end);
+    std::ranges::sort(long_items, {}, key_of);
+
+    for (size_t i = 0; i < long_items.size();) {
+        uint32_t key = key_of(long_items[i]);
+        size_t j = i;
+        unsigned group_max = 0;
+        while (j < long_items.size() && key_of(long_items[j]) == key)
+            group_max = std::max<unsigned>(group_max, long_items[j++].length);
+
+        if (table_[base + key] != 0) return std::unexpected(HuffmanError::InvalidFormat);
+        unsigned sub_bits = std::min(group_max - depth - bits, PRIMARY_BITS);
+        auto sub = BuildLevel(long_items.subspan(i, j - i), depth + bits, sub_bits);
+        if (!sub) return sub;
+        table_[base + key] = (static_cast<uint32_t>(sub.value()) << 8) | LINK_FLAG | sub_bits;
+        i = j;
+    }
+    return base;
+}
+
+inline uint32_t HuffmanDecodeTable::Lookup(uint64_t bits) const {
+    uint32_t entry = table_[bits & ((1u << PRIMARY_BITS) - 1)];
+    unsigned shift = PRIMARY_BITS;
+    while (entry & LINK_FLAG) {
+        unsigned sub_bits = entry & LENGTH_MASK;
+        entry = table_[(entry >> 8) + ((bits >> shift) & ((1u << sub_bits) - 1))];
+        shift += sub_bits;
+    }
+    return entry;
+}
+
+std::expected<void, HuffmanError> HuffmanDecodeTable::Decode(BitReader& br, std::span<uint8_t> out) const {
+    const unsigned per_refill = std::max(1u, BitReader::MAX_PEEK_BITS / max_length_);
+
+    size_t i = 0;
+    while (i < out.size()) {
+        br.Refill();
+        const size_t n = std::min<size_t>(per_refill, out.size() - i);
+        for (size_t k = 0; k < n; ++k) {
+            uint32_t entry = Lookup(br.PeekBits(BitReader::MAX_PEEK_BITS));
+            unsigned length = entry & LENGTH_MASK;
+            if (length == 0 || !br.ConsumeBits(length)) return std::unexpected(HuffmanError::InvalidFormat);
+            out[i++] = static_cast<uint8_t>(entry >> 8);
+        }
+    }
+    return {};
+}
+
+std::expected<void, HuffmanError> HuffmanDecodeTable::Decode(std::span<BitReader, 4> streams, std::span<uint8_t> out) const {
+    const unsigned per_refill = std::max(1u, BitReader::MAX_PEEK_BITS / max_length_);
+    const size_t group = 4 * static_cast<size_t>(per_refill);
+
+    size_t i = 0;
+    while (out.size() - i >= group) {
+        for (BitReader& br : streams) br.Refill();
+        for (unsigned k = 0; k < per_refill; ++k, i += 4) {
+            uint32_t e0 = Lookup(streams[0].PeekBits(BitReader::MAX_PEEK_BITS));
+            uint32_t e1 = Lookup(streams[1].PeekBits(BitReader::MAX_PEEK_BITS));
+            uint32_t e2 = Lookup(streams[2].PeekBits(BitReader::MAX_PEEK_BITS));
+            uint32_t e3 = Lookup(streams[3].PeekBits(BitReader::MAX_PEEK_BITS));
+            if ((e0 & LENGTH_MASK) == 0 || !streams[0].ConsumeBits(e0 & LENGTH_MASK) ||
+                (e1 & LENGTH_MASK) == 0 || !streams[1].ConsumeBits(e1 & LENGTH_MASK) ||
+                (e2 & LENGTH_MASK) == 0 || !streams[2].ConsumeBits(e2 & LENGTH_MASK) ||
+                (e3 & LENGTH_MASK) == 0 || !streams[3].ConsumeBits(e3 & LENGTH_MASK))
+                return std::unexpected(HuffmanError::InvalidFormat);
+            out[i] = static_cast<uint8_t>(e0 >> 8);
+            out[i + 1] = static_cast<uint8_t>(e1 >> 8);
+            out[i + 2] = static_cast<uint8_t>(e2 >> 8);
+            out[i + 3] = static_cast<uint8_t>(e3 >> 8);
+        }
+    }
+    for (; i < out.size(); ++i) {
+        BitReader& br = streams[i % 4];
+        br.Refill();
+        uint32_t entry = Lookup(br.PeekBits(BitReader::MAX_PEEK_BITS));
+        unsigned length = entry & LENGTH_MASK;
+        if (length == 0 || !br.ConsumeBits(length)) return std::unexpected(HuffmanError::InvalidFormat);
+        out[i] = static_cast<uint8_t>(entry >> 8);
+    }
+    return {};
+}
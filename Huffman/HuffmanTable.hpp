@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Huffman.hpp"
+#include "../BitStream/BitStream.hpp"
+#include <array>
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <expected>
+
+class HuffmanCodeBuilder {
+public:
+    static constexpr unsigned MIN_LENGTH_LIMIT = 8;
+    static constexpr unsigned MAX_LENGTH_LIMIT = 15;
+
+    static std::array<uint8_t, 256> BuildLengths(const std::array<uint64_t, 256>& freqs, unsigned max_length);
+    static std::array<uint64_t, 256> BuildCanonicalCodes(const std::array<uint8_t, 256>& lengths);
+    static bool IsComplete(const std::array<uint8_t, 256>& lengths, unsigned max_length);
+
+    static std::array<uint8_t, 128> PackLengths(const std::array<uint8_t, 256>& lengths);
+    static std::array<uint8_t, 256> UnpackLengths(std::span<const uint8_t, 128> packed);
+};
+
+class HuffmanDecodeTable {
+public:
+    static constexpr unsigned PRIMARY_BITS = 11;
+    static constexpr unsigned MAX_CODE_LENGTH = BitReader::MAX_PEEK_BITS;
+
+    // codes[s] зберігаються в порядку запису в потік: перший біт коду — молодший.
+    std::expected<void, HuffmanError> Build(
+        const std::array<uint64_t, 256>& codes,
+        const std::array<uint8_t, 256>& lengths);
+
+    std::expected<void, HuffmanError> Decode(BitReader& br, std::span<uint8_t> out) const;
+
+    // Символ i читається з потоку i % 4; out має починатися з символу, кратного 4.
+    std::expected<void, HuffmanError> Decode(std::span<BitReader, 4> streams, std::span<uint8_t> out) const;
+
+private:
+    static constexpr uint32_t LENGTH_MASK = 0x3F;
+    static constexpr uint32_t LINK_FLAG = 0x40;
+
+    struct Item {
+        uint64_t code;
+        uint8_t length;
+        uint8_t symbol;
+    };
+
+    uint32_t Lookup(uint64_t bits) const;
+
+    std::expected<size_t, HuffmanError> BuildLevel(std::span<Item> items, unsigned depth, unsigned bits);
+
+    std::vector<uint32_t> table_;
+    unsigned max_length_ = 0;
+};
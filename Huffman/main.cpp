@@ -1,4 +1,6 @@
 #include "./Huffman.hpp"
+#include "../BitStream/ThreadPool.hpp"
+#include "../BitStream/CliArgs.hpp"
 #include <iostream>
 #include <print>
 #include <string>
@@ -17,8 +19,8 @@ bool askUser(const std::string& filename) {
 
 void PrintHelp(const char* prog_name) {
     std::println("Usage:");
-    std::println("  Compress:   {} -c <input_file> [output_file] [--bwt] [--mtf]", prog_name);
-    std::println("  Decompress: {} -d <input_file> [output_file]", prog_name);
+    std::println("  Compress:   {} -c <input_file> [output_file] [--max-code-len 8-15] [--four-streams] [--block-size KiB] [--threads N] [--bwt] [--mtf] [--zero-runs] [--bwt-block KiB] [--bwt-memory MiB] [--bwt-chains 1-8]", prog_name);
+    std::println("  Decompress: {} -d <input_file> [output_file] [--threads N] [--bwt-memory MiB]", prog_name);
 }
 
 int main(int argc, char* argv[]) {
@@ -32,11 +34,69 @@ int main(int argc, char* argv[]) {
     std::filesystem::path out_file;
     bool use_bwt = false;
     bool use_mtf = false;
+    uint8_t max_code_length = 15;
+    bool four_streams = false;
+    uint32_t block_size = 0;
+    unsigned threads = 0;
+    uint32_t bwt_block_size = 0;
+    size_t bwt_memory = 0;
+    uint8_t bwt_chains = 1;
+    bool use_zero_runs = false;
 
     for (int i = 2; i < argc; ++i) {
         std::string arg = argv[i];
-        if (arg == "--bwt") use_bwt = true;
+        if (arg == "--max-code-len") {
+            auto len = ParseUnsigned(argc, argv, i, 8, 15);
+            if (!len) {
+                std::println(stderr, "Error: {}", HuffmanError_to_string(HuffmanError::InvalidCodeLength));
+                return 1;
+            }
+            max_code_length = static_cast<uint8_t>(*len);
+        }
+        else if (arg == "--block-size") {
+            auto kib = ParseUnsigned(argc, argv, i, 1, 256 * 1024);
+            if (!kib) {
+                std::println(stderr, "Error: {}", HuffmanError_to_string(HuffmanError::InvalidBlockSize));
+                return 1;
+            }
+            block_size = static_cast<uint32_t>(*kib * 1024);
+        }
+        else if (arg == "--bwt-block") {
+            auto kib = ParseUnsigned(argc, argv, i, 1, 256 * 1024);
+            if (!kib) {
+                std::println(stderr, "Error: {}", HuffmanError_to_string(HuffmanError::InvalidBwtBlockSize));
+                return 1;
+            }
+            bwt_block_size = static_cast<uint32_t>(*kib * 1024);
+        }
+        else if (arg == "--bwt-memory") {
+            auto mib = ParseUnsigned(argc, argv, i, 1, 64 * 1024);
+            if (!mib) {
+                std::println(stderr, "Error: {}", HuffmanError_to_string(HuffmanError::InvalidBwtMemory));
+                return 1;
+            }
+            bwt_memory = static_cast<size_t>(*mib) * 1024 * 1024;
+        }
+        else if (arg == "--bwt-chains") {
+            auto chains = ParseUnsigned(argc, argv, i, 1, 8);
+            if (!chains) {
+                std::println(stderr, "Error: {}", HuffmanError_to_string(HuffmanError::InvalidBwtChains));
+                return 1;
+            }
+            bwt_chains = static_cast<uint8_t>(*chains);
+        }
+        else if (arg == "--threads") {
+            auto count = ParseUnsigned(argc, argv, i, 0, ThreadPool::MAX_THREADS);
+            if (!count) {
+                std::println(stderr, "Error: {}", HuffmanError_to_string(HuffmanError::InvalidThreadCount));
+                return 1;
+            }
+            threads = static_cast<unsigned>(*count);
+        }
+        else if (arg == "--four-streams") four_streams = true;
+        else if (arg == "--bwt") use_bwt = true;
         else if (arg == "--mtf") use_mtf = true;
+        else if (arg == "--zero-runs") use_zero_runs = true;
         else if (arg[0] != '-') {
             if (in_file.empty()) in_file = arg;
             else if (out_file.empty()) out_file = arg;
@@ -75,9 +135,9 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        std::println("Compressing '{}' with BWT={}, MTF={}...", in_file.string(), use_bwt, use_mtf);
+        std::println("Compressing '{}' with max_code_len={}, BWT={}, MTF={}...", in_file.string(), max_code_length, use_bwt, use_mtf);
 
-        auto result = HuffmanCoder::Compress(in_file, out_file, use_bwt, use_mtf);
+        auto result = HuffmanCoder::Compress(in_file, out_file, use_bwt, use_mtf, max_code_length, four_streams, block_size, threads, bwt_block_size, bwt_memory, bwt_chains, use_zero_runs);
 
         if (result) {
             const auto& stats = result.value();
@@ -127,7 +187,7 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        auto result = HuffmanCoder::Decompress(in_file, out_file);
+        auto result = HuffmanCoder::Decompress(in_file, out_file, threads, bwt_memory);
         if (result) std::println("Decompression successful!");
         else {
             std::println(stderr, "Error: {}", HuffmanError_to_string(result.error()));
@@ -1,9 +1,16 @@
 ﻿#include "LZW.hpp"
 #include "../BitStream/BitStream.hpp"
+#include "../BitStream/MappedFile.hpp"
+#include "../BitStream/ThreadPool.hpp"
 #include "../BWTorMTF/BWTorMTFSplitting.hpp"
 #include <fstream>
 #include <iostream>
-#include <array>
+#include <deque>
+#include <future>
+#include <limits>
+#include <algorithm>
+#include <bit>
+#include <optional>
 
 namespace {
     struct TempFile {
@@ -28,6 +35,16 @@ std::string_view LZWError_to_string(LZWError err) {
     case LZWError::NoMaxBit:        return "Не вказано значення max_bits після --max-bits.";
     case LZWError::TransformFailed: return "Помилка конвеєра перетворень BWT/MTF.";
     case LZWError::NoPathProvided:  return "Не вказано шлях до файлу.";
+    case LZWError::InvalidSegmentSize: return "Некоректний розмір сегмента. Максимум 256 МіБ.";
+    case LZWError::InvalidDictMemory:  return "Некоректний обсяг пам'яті словника.";
+    case LZWError::InvalidDictionary:  return "Некоректний файл словника або словник завеликий для обраного max_bits.";
+    case LZWError::DictionaryRequired: return "Архів стиснуто з попереднім словником. Вкажіть його через --dict.";
+    case LZWError::DictionaryMismatch: return "Словник не збігається з тим, яким стиснуто архів.";
+    case LZWError::InvalidBwtBlockSize: return "Некоректний розмір блоку BWT: від 1 КіБ до 256 МіБ і в межах бюджету пам'яті.";
+    case LZWError::InvalidBwtMemory:   return "Некоректний обсяг пам'яті BWT. Допустимо від 1 МіБ до 64 ГіБ.";
+    case LZWError::InvalidBwtChains:   return "Некоректна кількість ланцюжків BWT. Допустимо від 1 до 8.";
+    case LZWError::InvalidThreadCount: return "Некоректна кількість потоків. Допустимо від 0 (усі ядра) до 256.";
+    case LZWError::ConflictingResetMode: return "Режими --freeze, --clear, --adaptive і --dict-memory взаємовиключні.";
     default:                        return "Невідома помилка.";
     }
 }
@@ -54,11 +71,168 @@ std::expected<LZWHeader, LZWError> LZWCoder::ReadHeader(std::ifstream& in) {
         !in.read(reinterpret_cast<char*>(&transform_flags), 1))
         return std::unexpected(LZWError::InvalidFormat);
 
-    return LZWHeader{
-        name, max_bits, (behavior == 1),
-        (transform_flags & 1) != 0,
-        (transform_flags & 2) != 0
+    if (behavior > static_cast<uint8_t>(LZWResetMode::Lru))
+        return std::unexpected(LZWError::InvalidFormat);
+
+    LZWHeader header{
+        name, max_bits, static_cast<LZWResetMode>(behavior),
+        (transform_flags & FLAG_BWT) != 0,
+        (transform_flags & FLAG_MTF) != 0
     };
+
+    header.use_zero_runs = (transform_flags & FLAG_ZERO_RUNS) != 0;
+
+    if (transform_flags & FLAG_SEGMENTS) {
+        if (!in.read(reinterpret_cast<char*>(&header.segment_size), sizeof(header.segment_size)) ||
+            header.segment_size == 0 || header.segment_size > MAX_SEGMENT_SIZE)
+            return std::unexpected(LZWError::InvalidFormat);
+    }
+
+    if (header.reset_mode == LZWResetMode::Lru) {
+        if (max_bits < 9 || max_bits > 32 ||
+            !in.read(reinterpret_cast<char*>(&header.lru_capacity), sizeof(header.lru_capacity)) ||
+            header.lru_capacity < MIN_LRU_CAPACITY ||
+            header.lru_capacity > LruCapacity(MAX_DICT_MEMORY, FIRST_CODE, (1ULL << max_bits) - FIRST_CODE))
+            return std::unexpected(LZWError::InvalidFormat);
+    }
+
+    if (transform_flags & FLAG_PRESET) {
+        if (!in.read(reinterpret_cast<char*>(&header.dict_id), sizeof(header.dict_id)))
+            return std::unexpected(LZWError::InvalidFormat);
+        header.use_preset = true;
+    }
+    return header;
+}
+
+uint64_t LZWCoder::LruCapacity(size_t dict_memory, uint32_t base_code, uint64_t max_capacity) {
+    const uint64_t node = LZWLeafLru::NodeBytes();
+    const uint64_t base = base_code;
+    if (dict_memory < base * sizeof(DictEntry)) return 0;
+    const uint64_t decoder_capacity = (dict_memory - base * sizeof(DictEntry)) / (sizeof(DictEntry) + node);
+
+    // Таблиця кодера росте степенями двійки, тож перебираються її розміри й береться найкращий.
+    uint64_t best = 0;
+    for (uint64_t slots = LZWDictionary::SlotsFor(1); slots * LZWDictionary::SlotBytes() <= dict_memory; slots *= 2) {
+        if (slots / 2 <= base) continue;
+        const uint64_t encoder_capacity = std::min(slots / 2 - base, (dict_memory - slots * LZWDictionary::SlotBytes()) / node);
+        best = std::max(best, std::min({ encoder_capacity, decoder_capacity, max_capacity }));
+    }
+    return best;
+}
+
+uint32_t LZWCoder::DictionaryId(const std::vector<PresetEntry>& entries) {
+    uint32_t hash = 2166136261u;
+    auto mix = [&](uint8_t byte) { hash = (hash ^ byte) * 16777619u; };
+    for (const auto& e : entries) {
+        for (int shift = 0; shift < 32; shift += 8) mix(static_cast<uint8_t>(e.prefix >> shift));
+        mix(e.ch);
+    }
+    return hash;
+}
+
+uint8_t LZWCoder::InitialBits(uint32_t base_code) {
+    return static_cast<uint8_t>(std::max(9u, std::bit_width(base_code + 1)));
+}
+
+std::expected<LZWCoder::PresetDictionary, LZWError> LZWCoder::LoadDictionary(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return std::unexpected(LZWError::FileNotFound);
+
+    char magic[3];
+    uint8_t version = 0;
+    uint32_t count = 0;
+    if (!in.read(magic, 3) || std::string_view(magic, 3) != "LZD" ||
+        !in.read(reinterpret_cast<char*>(&version), 1) || version != DICT_FILE_VERSION ||
+        !in.read(reinterpret_cast<char*>(&count), sizeof(count)) ||
+        count == 0 || count > (1u << MAX_PRESET_BITS) - FIRST_CODE)
+        return std::unexpected(LZWError::InvalidDictionary);
+
+    PresetDictionary preset;
+    preset.entries.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        auto& e = preset.entries[i];
+        if (!in.read(reinterpret_cast<char*>(&e.prefix), sizeof(e.prefix)) ||
+            !in.read(reinterpret_cast<char*>(&e.ch), 1))
+            return std::unexpected(LZWError::InvalidDictionary);
+        // Префікс — корінь або раніший запис словника, але не службовий код.
+        if (e.prefix >= FIRST_CODE + i || e.prefix == CLEAR_CODE || e.prefix == EOF_CODE)
+            return std::unexpected(LZWError::InvalidDictionary);
+    }
+    preset.id = DictionaryId(preset.entries);
+    return preset;
+}
+
+std::expected<LZWDictionaryInfo, LZWError> LZWCoder::TrainDictionary(
+    const std::vector<std::filesystem::path>& samples,
+    const std::filesystem::path& dict_path, uint8_t max_bits)
+{
+    if (max_bits < MIN_PRESET_BITS || max_bits > MAX_PRESET_BITS) return std::unexpected(LZWError::LovHighMaxBit);
+    if (samples.empty()) return std::unexpected(LZWError::NoPathProvided);
+
+    const size_t max_entries = (size_t(1) << (max_bits - 1)) - FIRST_CODE;
+    LZWDictionary dict(max_bits);
+    std::vector<PresetEntry> entries;
+    std::vector<uint8_t> buf(INPUT_CHUNK_SIZE);
+
+    for (const auto& sample : samples) {
+        std::ifstream in(sample, std::ios::binary);
+        if (!in) return std::unexpected(LZWError::FileNotFound);
+
+        // Кожен зразок розбирається з порожнього префікса, як окремий малий файл.
+        bool has_prefix = false;
+        uint32_t prefix = 0;
+        while (in.read(reinterpret_cast<char*>(buf.data()), buf.size()) || in.gcount() > 0) {
+            const size_t got = static_cast<size_t>(in.gcount());
+            for (size_t i = 0; i < got; ++i) {
+                const uint8_t c = buf[i];
+                if (!has_prefix) {
+                    prefix = c;
+                    has_prefix = true;
+                    continue;
+                }
+                uint32_t code = dict.Find(prefix, c);
+                if (code != LZWDictionary::NOT_FOUND) {
+                    prefix = code;
+                    continue;
+                }
+                if (entries.size() < max_entries) {
+                    dict.Insert(FIRST_CODE + static_cast<uint32_t>(entries.size()));
+                    entries.push_back({ prefix, c });
+                }
+                prefix = c;
+            }
+        }
+        if (in.bad()) return std::unexpected(LZWError::FileReadError);
+    }
+    if (entries.empty()) return std::unexpected(LZWError::EmptyFile);
+
+    std::ofstream out(dict_path, std::ios::binary);
+    if (!out) return std::unexpected(LZWError::FileWriteError);
+
+    const uint32_t count = static_cast<uint32_t>(entries.size());
+    out.write("LZD", 3);
+    out.write(reinterpret_cast<const char*>(&DICT_FILE_VERSION), 1);
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (const auto& e : entries) {
+        out.write(reinterpret_cast<const char*>(&e.prefix), sizeof(e.prefix));
+        out.write(reinterpret_cast<const char*>(&e.ch), 1);
+    }
+    if (!out) return std::unexpected(LZWError::FileWriteError);
+
+    return LZWDictionaryInfo{ DictionaryId(entries), count };
+}
+
+void LZWCoder::EncoderState::ResetDictionary() {
+    dict.Clear();
+    if (preset) {
+        for (size_t i = 0; i < preset->entries.size(); ++i) {
+            const auto& e = preset->entries[i];
+            if (dict.Find(e.prefix, e.ch) == LZWDictionary::NOT_FOUND)
+                dict.Insert(FIRST_CODE + static_cast<uint32_t>(i));
+        }
+    }
+    current_code = base_code;
+    bit_length = initial_bits;
 }
 
 std::expected<std::string, LZWError> LZWCoder::ExtractOriginalFilename(const std::filesystem::path& in_path) {
@@ -69,19 +243,431 @@ std::expected<std::string, LZWError> LZWCoder::ExtractOriginalFilename(const std
     return header_res->original_name;
 }
 
+std::expected<void, BitStreamError> LZWCoder::EncodeChunk(
+    EncoderState& state, std::span<const uint8_t> data, BitWriter& bw)
+{
+    const uint8_t* p = data.data();
+    const uint8_t* const end = p + data.size();
+    if (p == end) return {};
+
+    if (!state.has_prefix) {
+        if (auto res = bw.WriteBits(CLEAR_CODE, state.bit_length); !res) return res;
+        state.prefix = *p++;
+        state.has_prefix = true;
+    }
+
+    for (; p < end; ++p) {
+        const uint8_t c = *p;
+        uint32_t code = state.dict.Find(state.prefix, c);
+
+        if (code != LZWDictionary::NOT_FOUND) {
+            state.prefix = code;
+        }
+        else {
+            if (auto res = bw.WriteBits(state.prefix, state.bit_length); !res) return res;
+            if (state.reset_mode == LZWResetMode::Lru) {
+                state.lru.Touch(state.prefix);
+                if (state.current_code < state.code_limit) {
+                    state.dict.Insert(state.current_code);
+                    state.lru.Add(state.current_code, state.prefix, c);
+                    if (++state.current_code == (1ULL << state.bit_length) && state.bit_length < state.max_bits)
+                        state.bit_length++;
+                }
+                else if (uint32_t victim = state.lru.Victim(state.prefix); victim != LZWLeafLru::NONE) {
+                    state.dict.Erase(state.lru.Prefix(victim), state.lru.Symbol(victim));
+                    state.lru.Remove(victim);
+                    state.dict.Find(state.prefix, c);
+                    state.dict.Insert(victim);
+                    state.lru.Add(victim, state.prefix, c);
+                }
+            }
+            else if (state.is_frozen && state.reset_mode == LZWResetMode::Adaptive) {
+                state.window_bits += state.bit_length;
+                const uint64_t pos = state.consumed + static_cast<uint64_t>(p - data.data());
+                const uint64_t bytes = pos - state.window_start;
+                if (bytes >= ADAPTIVE_WINDOW_BYTES) {
+                    const uint64_t bits = state.window_bits;
+                    const bool expanding = bits > bytes * 8;
+                    if (!expanding && (state.best_bytes == 0 || bits * state.best_bytes < state.best_bits * bytes)) {
+                        state.best_bits = bits;
+                        state.best_bytes = bytes;
+                    }
+                    else if (expanding || bits * state.best_bytes * ADAPTIVE_THRESHOLD_DEN > state.best_bits * bytes * ADAPTIVE_THRESHOLD_NUM) {
+                        if (auto res = bw.WriteBits(CLEAR_CODE, state.bit_length); !res) return res;
+                        state.ResetDictionary();
+                        state.is_frozen = false;
+                        state.best_bits = 0;
+                        state.best_bytes = 0;
+                    }
+                    state.window_start = pos;
+                    state.window_bits = 0;
+                }
+            }
+            else if (!state.is_frozen) {
+                state.dict.Insert(state.current_code++);
+                if (state.current_code == (1ULL << state.bit_length)) {
+                    if (state.bit_length < state.max_bits) {
+                        state.bit_length++;
+                    }
+                    else {
+                        if (state.reset_mode == LZWResetMode::Clear) {
+                            if (auto res = bw.WriteBits(CLEAR_CODE, state.bit_length); !res) return res;
+                            state.ResetDictionary();
+                        }
+                        else {
+                            state.is_frozen = true;
+                            state.window_start = state.consumed + static_cast<uint64_t>(p - data.data());
+                            state.window_bits = 0;
+                        }
+                    }
+                }
+            }
+            state.prefix = c;
+        }
+    }
+    state.consumed += data.size();
+    return {};
+}
+
+std::expected<void, BitStreamError> LZWCoder::FinishEncode(EncoderState& state, BitWriter& bw) {
+    if (auto res = bw.WriteBits(state.prefix, state.bit_length); !res) return res;
+    return bw.WriteBits(EOF_CODE, state.bit_length);
+}
+
+std::expected<void, LZWError> LZWCoder::DecodeCodes(
+    std::span<const uint8_t> payload, const LZWHeader& header, const PresetDictionary* preset,
+    std::ostream* out, std::span<uint8_t> fixed_out)
+{
+    const uint8_t max_bits = header.max_bits;
+    const LZWResetMode reset_mode = header.reset_mode;
+    const bool is_lru = (reset_mode == LZWResetMode::Lru);
+    const uint32_t base_code = preset ? preset->BaseCode() : FIRST_CODE;
+    const uint8_t initial_bits = InitialBits(base_code);
+    const uint32_t code_limit = base_code + header.lru_capacity;
+    // Кожен код додає щонайбільше один запис, тож payload обмежує словник незалежно від заголовка.
+    const uint64_t max_new_codes = uint64_t(payload.size()) * 8 / initial_bits + 1;
+    LZWLeafLru lru(base_code, static_cast<uint32_t>(std::min<uint64_t>(header.lru_capacity, max_new_codes)));
+
+    std::vector<DictEntry> dict;
+    if (is_lru) dict.reserve(static_cast<size_t>(std::min<uint64_t>(code_limit, base_code + max_new_codes)));
+    else if (max_bits <= 24) {
+        uint64_t max_entries = std::min<uint64_t>(uint64_t(1) << max_bits, base_code + max_new_codes);
+        if (!out) max_entries = std::min<uint64_t>(max_entries, fixed_out.size() + base_code);
+        dict.reserve(static_cast<size_t>(max_entries));
+    }
+    dict.resize(FIRST_CODE);
+    // Рядки попереднього словника не лежать у вікні виводу: PRESET_POS змушує розгортати їх ланцюжком.
+    if (preset) {
+        for (const auto& e : preset->entries) {
+            const bool root = e.prefix < 256;
+            dict.push_back({ e.prefix, e.ch,
+                root ? static_cast<uint8_t>(e.prefix) : dict[e.prefix].first,
+                (root ? 1 : dict[e.prefix].len) + 1, PRESET_POS });
+        }
+    }
+
+    uint32_t current_code = base_code;
+    uint8_t  bit_length = initial_bits;
+    bool     is_frozen = false;
+    uint32_t old_code = EOF_CODE;
+    uint8_t  first_char = 0;
+    uint8_t  old_first = 0;
+    uint32_t old_len = 0;
+    uint64_t old_pos = 0;
+
+    // Без потоку виходом є сам fixed_out: вікно ніколи не скидається.
+    std::vector<uint8_t> buffer;
+    std::span<uint8_t> window = fixed_out;
+    if (out) {
+        buffer.resize(DECODE_WINDOW_SIZE);
+        window = buffer;
+    }
+    size_t   fill = 0;
+    uint64_t window_base = 0;
+
+    auto reserve = [&](size_t n) -> std::expected<void, LZWError> {
+        if (fill + n <= window.size()) return {};
+        if (!out) return std::unexpected(LZWError::InvalidFormat);
+        out->write(reinterpret_cast<const char*>(window.data()), static_cast<std::streamsize>(fill));
+        window_base += fill;
+        fill = 0;
+        if (n > buffer.size()) {
+            buffer.resize(n);
+            window = buffer;
+        }
+        if (!*out) return std::unexpected(LZWError::FileWriteError);
+        return {};
+        };
+
+    // Записує рядок коду з кінця до початку; щойно предок ще у вікні — копіює його цілим.
+    auto write_string = [&](uint32_t code, uint8_t* dst) {
+        uint8_t* p = dst + (code < 256 ? 1 : dict[code].len);
+        while (code >= 256) {
+            const DictEntry& e = dict[code];
+            if (e.pos - window_base < fill) {
+                std::memcpy(dst, window.data() + (e.pos - window_base), e.len);
+                return;
+            }
+            *--p = e.ch;
+            code = e.prefix;
+        }
+        *--p = static_cast<uint8_t>(code);
+        };
+
+    BitReader br(payload);
+
+    auto read_code = [&]() -> std::expected<uint32_t, LZWError> {
+        auto code = br.ReadBits(bit_length);
+        if (!code) return std::unexpected(LZWError::InvalidFormat);
+        return static_cast<uint32_t>(code.value());
+        };
+
+    while (true) {
+        auto code_res = read_code();
+        if (!code_res) break;
+        uint32_t code = code_res.value();
+
+        if (code == EOF_CODE) break;
+
+        if (code == CLEAR_CODE) {
+            dict.resize(base_code);
+            current_code = base_code;
+            bit_length = initial_bits;
+            is_frozen = false;
+            // Перший код після CLEAR нічого не додає; з попереднім словником це може бути й не корінь.
+            old_code = EOF_CODE;
+            continue;
+        }
+
+        // Код, який отримає наступний запис; у заповненому LRU-словнику це витіснений лист.
+        uint32_t next_code = current_code;
+        if (is_lru && current_code >= code_limit)
+            next_code = (old_code != EOF_CODE) ? lru.Victim(old_code) : LZWLeafLru::NONE;
+
+        uint32_t len;
+        if (is_lru && current_code >= code_limit ? code == next_code : code >= current_code) {
+            if (old_code == EOF_CODE) return std::unexpected(LZWError::InvalidFormat);
+            len = old_len + 1;
+            if (auto res = reserve(len); !res) return res;
+            write_string(old_code, window.data() + fill);
+            window[fill + old_len] = old_first;
+            first_char = old_first;
+        }
+        else {
+            if (code >= dict.size()) return std::unexpected(LZWError::InvalidFormat);
+            len = code < 256 ? 1 : dict[code].len;
+            if (auto res = reserve(len); !res) return res;
+            write_string(code, window.data() + fill);
+            first_char = code < 256 ? static_cast<uint8_t>(code) : dict[code].first;
+        }
+        const uint64_t pos = window_base + fill;
+        fill += len;
+
+        if (is_lru) {
+            if (old_code != EOF_CODE) {
+                const DictEntry entry{ old_code, first_char, old_first, old_len + 1, old_pos };
+                if (current_code < code_limit) {
+                    dict.push_back(entry);
+                    lru.Add(current_code, old_code, first_char);
+                    if (++current_code == (1ULL << bit_length) - 1 && bit_length < max_bits)
+                        bit_length++;
+                }
+                else if (next_code != LZWLeafLru::NONE) {
+                    lru.Remove(next_code);
+                    dict[next_code] = entry;
+                    lru.Add(next_code, old_code, first_char);
+                }
+            }
+            lru.Touch(code);
+        }
+        else if (!is_frozen && old_code != EOF_CODE) {
+            dict.push_back({ old_code, first_char, old_first, old_len + 1, old_pos });
+            current_code++;
+
+            if (current_code == (1ULL << bit_length) - 1) {
+                if (bit_length < max_bits) {
+                    bit_length++;
+                }
+            }
+
+            if (current_code == (1ULL << max_bits)) {
+                if (reset_mode != LZWResetMode::Clear) {
+                    is_frozen = true;
+                }
+            }
+        }
+        old_code = code;
+        old_first = first_char;
+        old_len = len;
+        old_pos = pos;
+    }
+
+    if (!out) {
+        if (fill != fixed_out.size()) return std::unexpected(LZWError::InvalidFormat);
+        return {};
+    }
+    out->write(reinterpret_cast<const char*>(window.data()), static_cast<std::streamsize>(fill));
+    if (!*out) return std::unexpected(LZWError::FileWriteError);
+    return {};
+}
+
+std::expected<uintmax_t, LZWError> LZWCoder::CompressSegments(
+    std::istream& in, std::ostream& out, uint32_t segment_size,
+    const LZWHeader& header, const PresetDictionary* preset, unsigned threads)
+{
+    struct PendingSegment {
+        uint32_t raw_size;
+        std::future<std::expected<std::vector<uint8_t>, LZWError>> result;
+    };
+
+    ThreadPool pool(threads);
+    const size_t max_in_flight = 2 * pool.Size();
+    std::deque<PendingSegment> pending;
+    std::vector<SegmentIndexEntry> index;
+
+    auto write_front = [&]() -> std::expected<void, LZWError> {
+        PendingSegment front = std::move(pending.front());
+        pending.pop_front();
+        auto segment = front.result.get();
+        if (!segment) return std::unexpected(segment.error());
+
+        index.push_back({ static_cast<uint64_t>(out.tellp()), static_cast<uint32_t>(segment->size()), front.raw_size });
+        out.write(reinterpret_cast<const char*>(segment->data()), static_cast<std::streamsize>(segment->size()));
+        if (!out) return std::unexpected(LZWError::FileWriteError);
+        return {};
+    };
+
+    while (true) {
+        std::vector<uint8_t> data(segment_size);
+        in.read(reinterpret_cast<char*>(data.data()), segment_size);
+        const auto got = static_cast<uint32_t>(in.gcount());
+        if (got == 0) break;
+        data.resize(got);
+
+        pending.push_back({ got, pool.Submit([data = std::move(data), &header, preset]()
+            -> std::expected<std::vector<uint8_t>, LZWError> {
+            std::vector<uint8_t> encoded;
+            {
+                EncoderState state(header.max_bits, header.reset_mode, header.lru_capacity, preset);
+                BitWriter bw(encoded);
+                if (!EncodeChunk(state, data, bw) || !FinishEncode(state, bw))
+                    return std::unexpected(LZWError::FileWriteError);
+            }
+            return encoded;
+        }) });
+
+        if (pending.size() >= max_in_flight) {
+            if (auto res = write_front(); !res) return std::unexpected(res.error());
+        }
+    }
+    while (!pending.empty()) {
+        if (auto res = write_front(); !res) return std::unexpected(res.error());
+    }
+
+    for (const auto& entry : index) {
+        out.write(reinterpret_cast<const char*>(&entry.offset), sizeof(entry.offset));
+        out.write(reinterpret_cast<const char*>(&entry.payload_size), sizeof(entry.payload_size));
+        out.write(reinterpret_cast<const char*>(&entry.raw_size), sizeof(entry.raw_size));
+    }
+    const uint64_t segment_count = index.size();
+    out.write(reinterpret_cast<const char*>(&segment_count), sizeof(segment_count));
+    if (!out) return std::unexpected(LZWError::FileWriteError);
+    return index.size() * INDEX_ENTRY_SIZE + sizeof(segment_count);
+}
+
+std::expected<void, LZWError> LZWCoder::DecompressSegments(
+    std::span<const uint8_t> archive, size_t payload_offset, const LZWHeader& header,
+    const PresetDictionary* preset, const std::filesystem::path& out_path, unsigned threads)
+{
+    uint64_t segment_count = 0;
+    if (archive.size() < payload_offset + sizeof(segment_count)) return std::unexpected(LZWError::InvalidFormat);
+    std::memcpy(&segment_count, archive.data() + archive.size() - sizeof(segment_count), sizeof(segment_count));
+
+    const size_t trailer_space = archive.size() - payload_offset - sizeof(segment_count);
+    if (segment_count > trailer_space / INDEX_ENTRY_SIZE) return std::unexpected(LZWError::InvalidFormat);
+    const size_t index_offset = archive.size() - sizeof(segment_count) - static_cast<size_t>(segment_count) * INDEX_ENTRY_SIZE;
+
+    std::vector<SegmentIndexEntry> index(static_cast<size_t>(segment_count));
+    uint64_t total_size = 0;
+    const uint8_t* p = archive.data() + index_offset;
+    for (auto& entry : index) {
+        std::memcpy(&entry.offset, p, sizeof(entry.offset));
+        std::memcpy(&entry.payload_size, p + 8, sizeof(entry.payload_size));
+        std::memcpy(&entry.raw_size, p + 12, sizeof(entry.raw_size));
+        p += INDEX_ENTRY_SIZE;
+
+        if (entry.raw_size == 0 || entry.raw_size > header.segment_size ||
+            entry.offset < payload_offset || entry.offset > index_offset ||
+            entry.payload_size > index_offset - entry.offset)
+            return std::unexpected(LZWError::InvalidFormat);
+        total_size += entry.raw_size;
+    }
+    if (total_size > std::numeric_limits<size_t>::max()) return std::unexpected(LZWError::FileWriteError);
+
+    auto out_file = MappedFile::Create(out_path, static_cast<size_t>(total_size));
+    if (!out_file) return std::unexpected(LZWError::FileWriteError);
+    std::span<uint8_t> out = out_file->MutableData();
+
+    ThreadPool pool(ThreadPool::WorkerCount(threads, index.size()));
+    std::vector<std::future<std::expected<void, LZWError>>> results;
+    results.reserve(index.size());
+
+    size_t out_offset = 0;
+    for (const auto& entry : index) {
+        auto payload = archive.subspan(static_cast<size_t>(entry.offset), entry.payload_size);
+        auto segment = out.subspan(out_offset, entry.raw_size);
+        results.push_back(pool.Submit([payload, segment, &header, preset] {
+            return DecodeCodes(payload, header, preset, nullptr, segment);
+        }));
+        out_offset += entry.raw_size;
+    }
+
+    std::expected<void, LZWError> status;
+    for (auto& result : results) {
+        auto res = result.get();
+        if (!res && status) status = res;
+    }
+    return status;
+}
+
 std::expected<LZWStats, LZWError> LZWCoder::Compress(
     const std::filesystem::path& in_path, std::filesystem::path out_path,
-    uint8_t max_bits, bool clear_on_overflow, bool use_bwt, bool use_mtf)
+    uint8_t max_bits, LZWResetMode reset_mode, bool use_bwt, bool use_mtf,
+    uint32_t segment_size, unsigned threads, size_t dict_memory,
+    const std::filesystem::path& dict_path, uint32_t bwt_block_size, size_t bwt_memory, uint8_t bwt_chains, bool use_zero_runs)
 {
     if (max_bits < 9 || max_bits > 32) return std::unexpected(LZWError::LovHighMaxBit);
+    if (segment_size > MAX_SEGMENT_SIZE) return std::unexpected(LZWError::InvalidSegmentSize);
+    if ((use_bwt || use_mtf || use_zero_runs) && !TransformSplitting::ValidateBlockSize(bwt_block_size, bwt_memory))
+        return std::unexpected(LZWError::InvalidBwtBlockSize);
+    if (bwt_chains > TransformSplitting::MAX_BWT_CHAINS) return std::unexpected(LZWError::InvalidBwtChains);
+
+    std::optional<PresetDictionary> preset;
+    if (!dict_path.empty()) {
+        auto loaded = LoadDictionary(dict_path);
+        if (!loaded) return std::unexpected(loaded.error());
+        if (InitialBits(loaded->BaseCode()) > max_bits) return std::unexpected(LZWError::InvalidDictionary);
+        preset = std::move(*loaded);
+    }
+    const PresetDictionary* preset_ptr = preset ? &*preset : nullptr;
+    const uint32_t base_code = preset ? preset->BaseCode() : FIRST_CODE;
+
+    uint32_t lru_capacity = 0;
+    if (reset_mode == LZWResetMode::Lru) {
+        if (dict_memory == 0) dict_memory = DEFAULT_DICT_MEMORY;
+        const uint64_t max_capacity = (1ULL << max_bits) - base_code;
+        const uint64_t capacity = LruCapacity(dict_memory, base_code, max_capacity);
+        if (capacity < MIN_LRU_CAPACITY) return std::unexpected(LZWError::InvalidDictMemory);
+        lru_capacity = static_cast<uint32_t>(capacity);
+    }
     if (out_path.empty()) out_path = in_path.string() + ".lzw";
 
     std::filesystem::path data_to_compress = in_path;
     TempFile temp_;
 
-    if (use_bwt || use_mtf) {
+    if (use_bwt || use_mtf || use_zero_runs) {
         auto temp_file = std::filesystem::temp_directory_path() / (in_path.filename().string() + ".lzw.tmp");
-        if (!TransformSplitting::ApplyForward(in_path, temp_file, use_bwt, use_mtf))
+        if (!TransformSplitting::ApplyForward(in_path, temp_file, use_bwt, use_mtf, threads, bwt_block_size, bwt_memory, bwt_chains, use_zero_runs))
             return std::unexpected(LZWError::TransformFailed);
         data_to_compress = temp_file;
         temp_.path = temp_file;
@@ -91,7 +677,8 @@ std::expected<LZWStats, LZWError> LZWCoder::Compress(
     if (!in) return std::unexpected(LZWError::FileNotFound);
 
     in.seekg(0, std::ios::end);
-    if (in.tellg() == 0) return std::unexpected(LZWError::EmptyFile);
+    const uint64_t data_size = static_cast<uint64_t>(in.tellg());
+    if (data_size == 0) return std::unexpected(LZWError::EmptyFile);
     uintmax_t orig_size = std::filesystem::file_size(in_path);
     in.seekg(0, std::ios::beg);
 
@@ -107,81 +694,59 @@ std::expected<LZWStats, LZWError> LZWCoder::Compress(
     out.write(orig_name.data(), name_len);
     out.write(reinterpret_cast<const char*>(&max_bits), 1);
 
-    uint8_t behavior_flag = clear_on_overflow ? 1 : 0;
+    uint8_t behavior_flag = static_cast<uint8_t>(reset_mode);
     out.write(reinterpret_cast<const char*>(&behavior_flag), 1);
 
-    uint8_t transform_flags = (use_bwt ? 1 : 0) | (use_mtf ? 2 : 0);
+    uint8_t transform_flags = (use_bwt ? FLAG_BWT : 0) | (use_mtf ? FLAG_MTF : 0) | (segment_size > 0 ? FLAG_SEGMENTS : 0) | (preset ? FLAG_PRESET : 0)
+        | (use_zero_runs ? FLAG_ZERO_RUNS : 0);
     out.write(reinterpret_cast<const char*>(&transform_flags), 1);
 
     uintmax_t meta_size = 3 + 1 + name_len + 1 + 1 + 1;
 
-    std::unordered_map<uint64_t, uint32_t> dict;
-    if (max_bits <= 24) dict.reserve(1ULL << max_bits);
+    if (segment_size > 0) {
+        out.write(reinterpret_cast<const char*>(&segment_size), sizeof(segment_size));
+        meta_size += sizeof(segment_size);
+    }
+    if (reset_mode == LZWResetMode::Lru) {
+        out.write(reinterpret_cast<const char*>(&lru_capacity), sizeof(lru_capacity));
+        meta_size += sizeof(lru_capacity);
+    }
+    if (preset) {
+        out.write(reinterpret_cast<const char*>(&preset->id), sizeof(preset->id));
+        meta_size += sizeof(preset->id);
+    }
 
-    uint32_t current_code = FIRST_CODE;
-    uint8_t  bit_length = 9;
-    bool     is_frozen = false;
+    const LZWHeader header{ orig_name, max_bits, reset_mode, use_bwt, use_mtf, segment_size, lru_capacity,
+        preset.has_value(), preset ? preset->id : 0, use_zero_runs };
+
+    if (segment_size > 0) {
+        const unsigned workers = ThreadPool::WorkerCount(threads, (data_size + segment_size - 1) / segment_size);
+        auto index_size = CompressSegments(in, out, segment_size, header, preset_ptr, workers);
+        if (!index_size) return std::unexpected(index_size.error());
+        meta_size += *index_size;
+        out.close();
+        return LZWStats{ orig_size, std::filesystem::file_size(out_path), meta_size };
+    }
 
     {
+        EncoderState state(max_bits, reset_mode, lru_capacity, preset_ptr);
         BitWriter bw(out);
 
-        auto write_code = [&](uint32_t code) -> bool {
-            std::array<uint8_t, 4> data = {
-                static_cast<uint8_t>(code & 0xFF),
-                static_cast<uint8_t>((code >> 8) & 0xFF),
-                static_cast<uint8_t>((code >> 16) & 0xFF),
-                static_cast<uint8_t>((code >> 24) & 0xFF)
-            };
-            return bw.WriteBitSequence(data, bit_length).has_value();
-            };
-
-        if (!write_code(CLEAR_CODE)) return std::unexpected(LZWError::FileWriteError);
-
-        int first_byte = in.get();
-        if (first_byte == EOF) return std::unexpected(LZWError::EmptyFile);
-        uint32_t prefix = static_cast<uint32_t>(first_byte);
-
-        int c;
-        while ((c = in.get()) != EOF) {
-            uint64_t key = (static_cast<uint64_t>(prefix) << 8) | static_cast<uint8_t>(c);
-            auto it = dict.find(key);
-
-            if (it != dict.end()) {
-                prefix = it->second;
-            }
-            else {
-                if (!write_code(prefix)) return std::unexpected(LZWError::FileWriteError);
-                if (!is_frozen) {
-                    dict[key] = current_code++;
-                    if (current_code == (1ULL << bit_length)) {
-                        if (bit_length < max_bits) {
-                            bit_length++;
-                        }
-                        else {
-                            if (clear_on_overflow) {
-                                if (!write_code(CLEAR_CODE)) return std::unexpected(LZWError::FileWriteError);
-                                dict.clear();
-                                current_code = FIRST_CODE;
-                                bit_length = 9;
-                            }
-                            else {
-                                is_frozen = true;
-                            }
-                        }
-                    }
-                }
-                prefix = static_cast<uint32_t>(c);
-            }
+        std::vector<uint8_t> buf(INPUT_CHUNK_SIZE);
+        while (in.read(reinterpret_cast<char*>(buf.data()), buf.size()) || in.gcount() > 0) {
+            std::span<const uint8_t> chunk(buf.data(), static_cast<size_t>(in.gcount()));
+            if (!EncodeChunk(state, chunk, bw)) return std::unexpected(LZWError::FileWriteError);
         }
-        if (!write_code(prefix))   return std::unexpected(LZWError::FileWriteError);
-        if (!write_code(EOF_CODE)) return std::unexpected(LZWError::FileWriteError);
+        if (!state.has_prefix) return std::unexpected(LZWError::EmptyFile);
+        if (!FinishEncode(state, bw)) return std::unexpected(LZWError::FileWriteError);
     }
 
     return LZWStats{ orig_size, std::filesystem::file_size(out_path), meta_size };
 }
 
 std::expected<void, LZWError> LZWCoder::Decompress(
-    const std::filesystem::path& in_path, std::filesystem::path out_path)
+    const std::filesystem::path& in_path, std::filesystem::path out_path, unsigned threads,
+    const std::filesystem::path& dict_path, size_t bwt_memory)
 {
     std::ifstream in(in_path, std::ios::binary);
     if (!in) return std::unexpected(LZWError::FileNotFound);
@@ -192,114 +757,53 @@ std::expected<void, LZWError> LZWCoder::Decompress(
     const auto& header = header_res.value();
     if (out_path.empty()) out_path = header.original_name;
 
+    std::optional<PresetDictionary> preset;
+    if (header.use_preset) {
+        if (dict_path.empty()) return std::unexpected(LZWError::DictionaryRequired);
+        auto loaded = LoadDictionary(dict_path);
+        if (!loaded) return std::unexpected(loaded.error());
+        if (loaded->id != header.dict_id) return std::unexpected(LZWError::DictionaryMismatch);
+        const uint32_t base_code = loaded->BaseCode();
+        if (InitialBits(base_code) > header.max_bits ||
+            (header.reset_mode == LZWResetMode::Lru && header.lru_capacity > (1ULL << header.max_bits) - base_code))
+            return std::unexpected(LZWError::InvalidFormat);
+        preset = std::move(*loaded);
+    }
+    const PresetDictionary* preset_ptr = preset ? &*preset : nullptr;
+
+    const auto payload_offset = static_cast<size_t>(in.tellg());
+    in.close();
+
+    auto mapped = MappedFile::Open(in_path);
+    if (!mapped) return std::unexpected(LZWError::FileReadError);
+    if (payload_offset > mapped->Data().size()) return std::unexpected(LZWError::InvalidFormat);
+
     std::filesystem::path extracted_data_path = out_path;
     TempFile temp_;
 
-    if (header.use_bwt || header.use_mtf) {
+    if (header.use_bwt || header.use_mtf || header.use_zero_runs) {
         auto temp_file = std::filesystem::temp_directory_path() / (out_path.filename().string() + ".lzw.tmp");
         extracted_data_path = temp_file;
         temp_.path = temp_file;
     }
 
-    std::ofstream out(extracted_data_path, std::ios::binary);
-    if (!out) return std::unexpected(LZWError::FileWriteError);
-
-    uint8_t max_bits = header.max_bits;
-    bool clear_on_overflow = header.clear_on_overflow;
-
-    std::vector<DictEntry> dict;
-    if (max_bits <= 24) dict.reserve(1ULL << max_bits);
-    dict.resize(FIRST_CODE);
-
-    uint32_t current_code = FIRST_CODE;
-    uint8_t  bit_length = 9;
-    bool     is_frozen = false;
-    uint32_t old_code = EOF_CODE;
-    uint8_t  first_char = 0;
-
-    {
-        BitReader br(in);
-
-        auto read_code = [&]() -> std::expected<uint32_t, LZWError> {
-            std::array<uint8_t, 4> data = { 0, 0, 0, 0 };
-            if (!br.ReadBitSequence(data, bit_length))
-                return std::unexpected(LZWError::InvalidFormat);
-            return static_cast<uint32_t>(data[0])
-                | (static_cast<uint32_t>(data[1]) << 8)
-                | (static_cast<uint32_t>(data[2]) << 16)
-                | (static_cast<uint32_t>(data[3]) << 24);
-            };
-
-        while (true) {
-            auto code_res = read_code();
-            if (!code_res) break;
-            uint32_t code = code_res.value();
-
-            if (code == EOF_CODE) break;
-
-            if (code == CLEAR_CODE) {
-                dict.clear();
-                dict.resize(FIRST_CODE);
-                current_code = FIRST_CODE;
-                bit_length = 9;
-                is_frozen = false;
-
-                auto next = read_code();
-                if (!next || next.value() == EOF_CODE) break;
-
-                first_char = static_cast<uint8_t>(next.value());
-                out.put(static_cast<char>(first_char));
-                old_code = next.value();
-                continue;
-            }
-
-            uint32_t curr = code;
-            std::vector<uint8_t> stack;
-
-            if (code >= current_code) {
-                if (old_code == EOF_CODE) return std::unexpected(LZWError::InvalidFormat);
-                curr = old_code;
-                stack.push_back(first_char);
-            }
-
-            while (curr >= 256) {
-                if (curr >= dict.size()) return std::unexpected(LZWError::InvalidFormat);
-                stack.push_back(dict[curr].ch);
-                curr = dict[curr].prefix;
-            }
-
-            first_char = static_cast<uint8_t>(curr);
-            stack.push_back(first_char);
-
-            for (auto it = stack.rbegin(); it != stack.rend(); ++it)
-                out.put(static_cast<char>(*it));
-
-            if (!is_frozen && old_code != EOF_CODE) {
-                dict.push_back({ old_code, first_char });
-                current_code++;
-
-                if (current_code == (1ULL << bit_length) - 1) {
-                    if (bit_length < max_bits) {
-                        bit_length++;
-                    }
-                }
-
-                if (current_code == (1ULL << max_bits)) {
-                    if (!clear_on_overflow) {
-                        is_frozen = true;
-                    }
-                }
-            }
-            old_code = code;
-        }
+    if (header.segment_size > 0) {
+        if (auto res = DecompressSegments(mapped->Data(), payload_offset, header, preset_ptr, extracted_data_path, threads); !res)
+            return res;
     }
+    else {
+        std::ofstream out(extracted_data_path, std::ios::binary);
+        if (!out) return std::unexpected(LZWError::FileWriteError);
 
-    out.close();
+        auto res = DecodeCodes(mapped->Data().subspan(payload_offset), header, preset_ptr, &out, {});
+        if (!res) return res;
+        out.close();
+    }
 
     if (!temp_.path.empty()) {
-        if (!TransformSplitting::ApplyReverse(temp_.path, out_path, header.use_bwt, header.use_mtf))
+        if (!TransformSplitting::ApplyReverse(temp_.path, out_path, header.use_bwt, header.use_mtf, threads, bwt_memory, header.use_zero_runs))
             return std::unexpected(LZWError::TransformFailed);
     }
 
     return {};
-}
\ No newline at end of file
+}
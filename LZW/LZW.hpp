@@ -6,14 +6,33 @@
 #include <expected>
 #include <string_view>
 #include <filesystem>
-#include <unordered_map>
+#include <span>
+#include "LZWDictionary.hpp"
+#include "../BitStream/BitStream.hpp"
+
+enum class LZWResetMode : uint8_t {
+    Freeze = 0,
+    Clear = 1,
+    Adaptive = 2,
+    Lru = 3
+};
 
 struct LZWHeader {
     std::string original_name;
     uint8_t max_bits;
-    bool clear_on_overflow;
+    LZWResetMode reset_mode;
     bool use_bwt;
     bool use_mtf; 
+    uint32_t segment_size = 0;
+    uint32_t lru_capacity = 0;
+    bool use_preset = false;
+    uint32_t dict_id = 0;
+    bool use_zero_runs = false;
+};
+
+struct LZWDictionaryInfo {
+    uint32_t id;
+    uint32_t entries;
 };
 
 struct LZWStats {
@@ -33,24 +52,56 @@ enum class LZWError {
     LovHighMaxBit,
     NoMaxBit,
     TransformFailed,
-    NoPathProvided
+    NoPathProvided,
+    InvalidSegmentSize,
+    InvalidDictMemory,
+    InvalidDictionary,
+    DictionaryRequired,
+    DictionaryMismatch,
+    InvalidBwtBlockSize,
+    InvalidBwtMemory,
+    InvalidBwtChains,
+    InvalidThreadCount,
+    ConflictingResetMode
 };
 
 std::string_view LZWError_to_string(LZWError err);
 
 class LZWCoder {
 public:
+    // Найбільший --dict-memory; ним же обмежується lru_capacity із заголовка архіву.
+    static constexpr size_t MAX_DICT_MEMORY = size_t(64) * 1024 * 1024 * 1024;
+
     static std::expected<LZWStats, LZWError> Compress(
         const std::filesystem::path& in_path,
         std::filesystem::path out_path = "",
         uint8_t max_bits = 16,
-        bool clear_on_overflow = true,
+        LZWResetMode reset_mode = LZWResetMode::Clear,
         bool use_bwt = false,
-        bool use_mtf = false);
+        bool use_mtf = false,
+        uint32_t segment_size = 0,
+        unsigned threads = 0,
+        size_t dict_memory = 0,
+        const std::filesystem::path& dict_path = "",
+        uint32_t bwt_block_size = 0,
+        size_t bwt_memory = 0,
+        uint8_t bwt_chains = 1,
+        bool use_zero_runs = false);
 
     static std::expected<void, LZWError> Decompress(
         const std::filesystem::path& in_path,
-        std::filesystem::path out_path = "");
+        std::filesystem::path out_path = "",
+        unsigned threads = 0,
+        const std::filesystem::path& dict_path = "",
+        size_t bwt_memory = 0);
+
+    // Будує попередній словник жадібним LZW-розбором зразків; записи займають коди з 258.
+    // Словник займає не більше половини кодів max_bits, тож стискати ним можна з --max-bits >= max_bits,
+    // і щонайменше половина кодів лишається для нових рядків.
+    static std::expected<LZWDictionaryInfo, LZWError> TrainDictionary(
+        const std::vector<std::filesystem::path>& samples,
+        const std::filesystem::path& dict_path,
+        uint8_t max_bits = 12);
 
     static std::expected<std::string, LZWError> ExtractOriginalFilename(
         const std::filesystem::path& in_path);
@@ -61,8 +112,116 @@ private:
     static constexpr uint32_t EOF_CODE = 257;
     static constexpr uint32_t FIRST_CODE = 258;
 
+    static constexpr uint8_t FLAG_BWT = 1;
+    static constexpr uint8_t FLAG_MTF = 2;
+    static constexpr uint8_t FLAG_SEGMENTS = 4;
+    static constexpr uint8_t FLAG_PRESET = 8;
+    static constexpr uint8_t FLAG_ZERO_RUNS = 16;
+
+    static constexpr uint8_t DICT_FILE_VERSION = 1;
+    static constexpr uint8_t MIN_PRESET_BITS = 10;
+    static constexpr uint8_t MAX_PRESET_BITS = 24;
+    static constexpr uint64_t PRESET_POS = UINT64_MAX;
+
+    static constexpr uint32_t MAX_SEGMENT_SIZE = 256u * 1024 * 1024;
+
+    // Lru: бюджет пам'яті перераховується в кількість записів словника, що зберігається в заголовку.
+    static constexpr size_t DEFAULT_DICT_MEMORY = 64 * 1024 * 1024;
+    static constexpr uint32_t MIN_LRU_CAPACITY = 64;
+
+    // Adaptive: CLEAR_CODE, коли бітів на байт у вікні стає більше за найкращий результат у 9/8 разу
+    // або вікно розширює дані (понад 8 бітів на байт).
+    static constexpr uint64_t ADAPTIVE_WINDOW_BYTES = 16 * 1024;
+    static constexpr uint64_t ADAPTIVE_THRESHOLD_NUM = 9;
+    static constexpr uint64_t ADAPTIVE_THRESHOLD_DEN = 8;
+
+    static constexpr size_t INPUT_CHUNK_SIZE = 1024 * 1024;
+    static constexpr size_t DECODE_WINDOW_SIZE = 4 * 1024 * 1024;
+
+    // pos — абсолютна позиція у виході, де рядок записа вже зустрічався цілим.
     struct DictEntry {
         uint32_t prefix;
         uint8_t ch;
+        uint8_t first;
+        uint32_t len;
+        uint64_t pos;
     };
+
+    struct PresetEntry {
+        uint32_t prefix;
+        uint8_t ch;
+    };
+
+    struct PresetDictionary {
+        uint32_t id = 0;
+        std::vector<PresetEntry> entries;
+
+        uint32_t BaseCode() const { return FIRST_CODE + static_cast<uint32_t>(entries.size()); }
+    };
+
+    static std::expected<PresetDictionary, LZWError> LoadDictionary(const std::filesystem::path& path);
+    static uint32_t DictionaryId(const std::vector<PresetEntry>& entries);
+    // Ширина коду після CLEAR: кодер розширює її на 2^n, декодер — на 2^n - 1, тож base + 1 має вміщатися.
+    static uint8_t InitialBits(uint32_t base_code);
+    // Найбільша кількість записів Lru-словника, для якої і кодер (вузли LRU + хеш-таблиця на всі коди),
+    // і декодер (вузли LRU + DictEntry на кожен код) вміщаються в dict_memory.
+    static uint64_t LruCapacity(size_t dict_memory, uint32_t base_code, uint64_t max_capacity);
+
+    struct EncoderState {
+        EncoderState(uint8_t max_bits, LZWResetMode reset_mode, uint32_t lru_capacity, const PresetDictionary* preset)
+            : dict(max_bits, reset_mode == LZWResetMode::Lru ? (preset ? preset->BaseCode() : FIRST_CODE) + lru_capacity : 0),
+            max_bits(max_bits), reset_mode(reset_mode), preset(preset),
+            base_code(preset ? preset->BaseCode() : FIRST_CODE), initial_bits(InitialBits(base_code)),
+            lru(base_code, lru_capacity), code_limit(base_code + lru_capacity)
+        {
+            ResetDictionary();
+        }
+
+        // Повертає словник до стану після CLEAR_CODE: лише корені та попередній словник.
+        void ResetDictionary();
+
+        LZWDictionary dict;
+        uint8_t  max_bits;
+        LZWResetMode reset_mode;
+        const PresetDictionary* preset;
+        uint32_t base_code;
+        uint8_t  initial_bits;
+        LZWLeafLru lru;
+        uint32_t code_limit;
+        uint32_t current_code = FIRST_CODE;
+        uint8_t  bit_length = 9;
+        bool     is_frozen = false;
+        uint32_t prefix = 0;
+        bool     has_prefix = false;
+
+        // Adaptive: статистика вікна після заморожування словника.
+        uint64_t consumed = 0;
+        uint64_t window_start = 0;
+        uint64_t window_bits = 0;
+        uint64_t best_bits = 0;
+        uint64_t best_bytes = 0;
+    };
+
+    struct SegmentIndexEntry {
+        uint64_t offset = 0;
+        uint32_t payload_size = 0;
+        uint32_t raw_size = 0;
+    };
+    static constexpr size_t INDEX_ENTRY_SIZE = sizeof(uint64_t) + 2 * sizeof(uint32_t);
+
+    static std::expected<void, BitStreamError> EncodeChunk(
+        EncoderState& state, std::span<const uint8_t> data, BitWriter& bw);
+    static std::expected<void, BitStreamError> FinishEncode(EncoderState& state, BitWriter& bw);
+
+    // Декодує потік кодів у out (через вікно) або, якщо out == nullptr, рівно у fixed_out.
+    static std::expected<void, LZWError> DecodeCodes(
+        std::span<const uint8_t> payload, const LZWHeader& header, const PresetDictionary* preset,
+        std::ostream* out, std::span<uint8_t> fixed_out);
+
+    static std::expected<uintmax_t, LZWError> CompressSegments(
+        std::istream& in, std::ostream& out, uint32_t segment_size,
+        const LZWHeader& header, const PresetDictionary* preset, unsigned threads);
+    static std::expected<void, LZWError> DecompressSegments(
+        std::span<const uint8_t> archive, size_t payload_offset, const LZWHeader& header,
+        const PresetDictionary* preset, const std::filesystem::path& out_path, unsigned threads);
 };
\ No newline at end of file
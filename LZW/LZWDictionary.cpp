@@ -0,0 +1,110 @@
+﻿#include "LZWDictionary.hpp"
+#include <algorithm>
+#include <bit>
+
+LZWDictionary::LZWDictionary(uint8_t max_bits, uint32_t max_entries) {
+    // Заповнення не перевищує половини: до 2^max_bits кодів на 2^(max_bits+1) слотів.
+    if (max_entries > 0) log2_slots_ = std::countr_zero(SlotsFor(max_entries));
+    else log2_slots_ = std::clamp<unsigned>(max_bits + 1u, MIN_LOG2_SLOTS, MAX_INITIAL_LOG2_SLOTS);
+    slots_.resize(size_t(1) << log2_slots_);
+    mask_ = slots_.size() - 1;
+}
+
+size_t LZWDictionary::SlotsFor(uint64_t entries) {
+    return size_t(1) << std::max<unsigned>(MIN_LOG2_SLOTS, std::bit_width(2 * entries - 1));
+}
+
+void LZWDictionary::Clear() {
+    count_ = 0;
+    if (++generation_ == 0) {
+        std::fill(slots_.begin(), slots_.end(), Slot{});
+        generation_ = 1;
+    }
+}
+
+void LZWDictionary::Erase(uint32_t prefix, uint8_t ch) {
+    if (Find(prefix, ch) == NOT_FOUND) return;
+    const uint64_t key = (static_cast<uint64_t>(prefix) << 8) | ch;
+    size_t hole = SlotIndex(key);
+    while (slots_[hole].key != key) hole = (hole + 1) & mask_;
+
+    for (size_t j = (hole + 1) & mask_; slots_[j].generation == generation_; j = (j + 1) & mask_) {
+        const size_t home = SlotIndex(slots_[j].key);
+        // Запис лишається на місці, якщо його домашній слот циклічно лежить у (hole, j].
+        const bool stays = (hole < j) ? (home > hole && home <= j) : (home > hole || home <= j);
+        if (!stays) {
+            slots_[hole] = slots_[j];
+            hole = j;
+        }
+    }
+    slots_[hole].generation = 0;
+    count_--;
+}
+
+void LZWDictionary::Grow() {
+    std::vector<Slot> old = std::move(slots_);
+    log2_slots_++;
+    slots_.assign(size_t(1) << log2_slots_, Slot{});
+    mask_ = slots_.size() - 1;
+
+    for (const Slot& slot : old) {
+        if (slot.generation != generation_) continue;
+        size_t i = SlotIndex(slot.key);
+        while (slots_[i].generation == generation_) i = (i + 1) & mask_;
+        slots_[i] = slot;
+    }
+}
+
+LZWLeafLru::LZWLeafLru(uint32_t first_code, uint32_t capacity)
+    : first_code_(first_code), nodes_(capacity) {}
+
+void LZWLeafLru::Link(uint32_t code) {
+    Node& node = At(code);
+    node.prev = tail_;
+    node.next = NONE;
+    node.linked = true;
+    if (tail_ != NONE) At(tail_).next = code;
+    else head_ = code;
+    tail_ = code;
+}
+
+void LZWLeafLru::Unlink(uint32_t code) {
+    Node& node = At(code);
+    if (node.prev != NONE) At(node.prev).next = node.next;
+    else head_ = node.next;
+    if (node.next != NONE) At(node.next).prev = node.prev;
+    else tail_ = node.prev;
+    node.linked = false;
+}
+
+void LZWLeafLru::Add(uint32_t code, uint32_t prefix, uint8_t ch) {
+    Node& node = At(code);
+    node.prefix = prefix;
+    node.ch = ch;
+    node.children = 0;
+    Link(code);
+    if (prefix >= first_code_) {
+        Node& parent = At(prefix);
+        if (parent.children++ == 0 && parent.linked) Unlink(prefix);
+    }
+}
+
+void LZWLeafLru::Remove(uint32_t code) {
+    Node& node = At(code);
+    if (node.linked) Unlink(code);
+    if (node.prefix >= first_code_) {
+        Node& parent = At(node.prefix);
+        if (--parent.children == 0) Link(node.prefix);
+    }
+}
+
+void LZWLeafLru::Touch(uint32_t code) {
+    if (code < first_code_ || !At(code).linked || code == tail_) return;
+    Unlink(code);
+    Link(code);
+}
+
+uint32_t LZWLeafLru::Victim(uint32_t exclude) const {
+    if (head_ != exclude) return head_;
+    return nodes_[head_ - first_code_].next;
+}
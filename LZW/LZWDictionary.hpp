@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Словник кодера LZW: відкрита адресація з лінійним пробуванням за ключем (prefix, ch).
+// Clear() виконується за O(1): слоти зі старим поколінням вважаються порожніми.
+class LZWDictionary {
+public:
+    static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+    static constexpr unsigned MIN_LOG2_SLOTS = 10;
+
+    // max_entries > 0 — словник обмеженого розміру (Lru): таблиця одразу на SlotsFor(max_entries) слотів і не росте.
+    explicit LZWDictionary(uint8_t max_bits, uint32_t max_entries = 0);
+
+    // Степінь двійки, не менша за 2 * entries: заповнення лишається не більшим за половину.
+    static size_t SlotsFor(uint64_t entries);
+    static constexpr size_t SlotBytes() { return sizeof(Slot); }
+
+    // Повертає код пари або NOT_FOUND; після промаху Insert() записує в знайдений вільний слот.
+    uint32_t Find(uint32_t prefix, uint8_t ch);
+    void Insert(uint32_t code);
+    // Видалення зі зсувом назад; скидає запам'ятований після Find() слот.
+    void Erase(uint32_t prefix, uint8_t ch);
+    void Clear();
+
+private:
+    static constexpr unsigned MAX_INITIAL_LOG2_SLOTS = 20;
+
+    struct Slot {
+        uint64_t key = 0;
+        uint32_t code = 0;
+        uint32_t generation = 0;
+    };
+
+    size_t SlotIndex(uint64_t key) const {
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> (64 - log2_slots_));
+    }
+    void Grow();
+
+    std::vector<Slot> slots_;
+    unsigned log2_slots_ = 0;
+    size_t mask_ = 0;
+    size_t count_ = 0;
+    uint32_t generation_ = 1;
+    uint64_t last_key_ = 0;
+    size_t last_slot_ = 0;
+};
+
+inline uint32_t LZWDictionary::Find(uint32_t prefix, uint8_t ch) {
+    const uint64_t key = (static_cast<uint64_t>(prefix) << 8) | ch;
+    size_t i = SlotIndex(key);
+    while (true) {
+        const Slot& slot = slots_[i];
+        if (slot.generation != generation_) break;
+        if (slot.key == key) return slot.code;
+        i = (i + 1) & mask_;
+    }
+    last_key_ = key;
+    last_slot_ = i;
+    return NOT_FOUND;
+}
+
+inline void LZWDictionary::Insert(uint32_t code) {
+    slots_[last_slot_] = { last_key_, code, generation_ };
+    if (++count_ * 2 > slots_.size()) Grow();
+}
+
+// Листові записи словника (без продовжень) у порядку останнього використання.
+// Кодер і декодер викликають ті самі операції в тому самому порядку, тож витіснення в них збігаються.
+class LZWLeafLru {
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    LZWLeafLru(uint32_t first_code, uint32_t capacity);
+
+    void Add(uint32_t code, uint32_t prefix, uint8_t ch);
+    void Remove(uint32_t code);
+    void Touch(uint32_t code);
+    // Найдавніше використаний лист, відмінний від exclude, або NONE.
+    uint32_t Victim(uint32_t exclude) const;
+
+    uint32_t Prefix(uint32_t code) const { return nodes_[code - first_code_].prefix; }
+    uint8_t Symbol(uint32_t code) const { return nodes_[code - first_code_].ch; }
+
+    static constexpr size_t NodeBytes() { return sizeof(Node); }
+
+private:
+    struct Node {
+        uint32_t prev = NONE;
+        uint32_t next = NONE;
+        uint32_t prefix = 0;
+        uint32_t children = 0;
+        uint8_t ch = 0;
+        bool linked = false;
+    };
+
+    Node& At(uint32_t code) { return nodes_[code - first_code_]; }
+    void Link(uint32_t code);
+    void Unlink(uint32_t code);
+
+    uint32_t first_code_;
+    std::vector<Node> nodes_;
+    uint32_t head_ = NONE;
+    uint32_t tail_ = NONE;
+};
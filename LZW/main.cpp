@@ -1,8 +1,11 @@
 #include "../LZW/LZW.hpp"
+#include "../BitStream/ThreadPool.hpp"
+#include "../BitStream/CliArgs.hpp"
 #include <iostream>
 #include <print>
 #include <string>
 #include <filesystem>
+#include <vector>
 
 bool askUser(const std::string& filename) {
     std::print("Output filename not specified. Use '{}'? [y/n]: ", filename);
@@ -17,8 +20,10 @@ bool askUser(const std::string& filename) {
 
 void PrintHelp(const char* prog_name) {
     std::println("Usage:");
-    std::println("  Compress:   {} -c <input_file> [output_file] [--max-bits 9-32] [--freeze | --clear] [--bwt] [--mtf]", prog_name);
-    std::println("  Decompress: {} -d <input_file> [output_file]", prog_name);
+    std::println("  Compress:   {} -c <input_file> [output_file] [--max-bits 9-32] [--freeze | --clear | --adaptive | --dict-memory MiB] [--segment-size KiB] [--threads N] [--dict <dict_file>] [--bwt] [--mtf] [--zero-runs] [--bwt-block KiB] [--bwt-memory MiB] [--bwt-chains 1-8]", prog_name);
+    std::println("  Decompress: {} -d <input_file> [output_file] [--threads N] [--dict <dict_file>] [--bwt-memory MiB]", prog_name);
+    std::println("  Train dict: {} -t <dict_file> <sample_file>... [--max-bits 10-24]", prog_name);
+    std::println("              The dictionary fills at most half of the --max-bits code space; compress with the same or larger --max-bits.");
 }
 
 int main(int argc, char* argv[]) {
@@ -30,45 +35,137 @@ int main(int argc, char* argv[]) {
     std::string mode = argv[1];
     std::filesystem::path in_file;
     std::filesystem::path out_file;
+    std::filesystem::path dict_file;
+    std::vector<std::filesystem::path> positionals;
     uint8_t max_bits = 16;
-    bool clear_mode = true;
+    bool max_bits_set = false;
+    LZWResetMode reset_mode = LZWResetMode::Clear;
+    bool reset_mode_set = false;
     bool use_bwt = false;
     bool use_mtf = false;
+    uint32_t segment_size = 0;
+    unsigned threads = 0;
+    size_t dict_memory = 0;
+    uint32_t bwt_block_size = 0;
+    size_t bwt_memory = 0;
+    uint8_t bwt_chains = 1;
+    bool use_zero_runs = false;
+
+    // Режим словника можна задати лише один раз; повтор того самого прапорця не є конфліктом.
+    auto select_reset_mode = [&](LZWResetMode mode) {
+        if (reset_mode_set && reset_mode != mode) return false;
+        reset_mode = mode;
+        reset_mode_set = true;
+        return true;
+        };
 
     for (int i = 2; i < argc; ++i) {
         std::string arg = argv[i];
         if (arg == "--max-bits") {
-            if (i + 1 < argc) {
-                try {
-                    int val = std::stoi(argv[++i]);
-                    if (val < 9 || val > 32) {
-                        std::println(stderr, "Error: {}", LZWError_to_string(LZWError::LovHighMaxBit));
-                        return 1;
-                    }
-                    max_bits = static_cast<uint8_t>(val);
-                }
-                catch (const std::exception&) {
-                    std::println(stderr, "Error: {}", LZWError_to_string(LZWError::NoMaxBit));
-                    return 1;
-                }
-            }
-            else {
+            if (i + 1 >= argc) {
                 std::println(stderr, "Error: {}", LZWError_to_string(LZWError::NoMaxBit));
                 return 1;
             }
+            auto bits = ParseUnsigned(argc, argv, i, 9, 32);
+            if (!bits) {
+                std::println(stderr, "Error: {}", LZWError_to_string(LZWError::LovHighMaxBit));
+                return 1;
+            }
+            max_bits = static_cast<uint8_t>(*bits);
+            max_bits_set = true;
+        }
+        else if (arg == "--segment-size") {
+            auto kib = ParseUnsigned(argc, argv, i, 1, 256 * 1024);
+            if (!kib) {
+                std::println(stderr, "Error: {}", LZWError_to_string(LZWError::InvalidSegmentSize));
+                return 1;
+            }
+            segment_size = static_cast<uint32_t>(*kib * 1024);
+        }
+        else if (arg == "--dict-memory") {
+            auto mib = ParseUnsigned(argc, argv, i, 1, LZWCoder::MAX_DICT_MEMORY / (1024 * 1024));
+            if (!mib) {
+                std::println(stderr, "Error: {}", LZWError_to_string(LZWError::InvalidDictMemory));
+                return 1;
+            }
+            dict_memory = static_cast<size_t>(*mib) * 1024 * 1024;
+            if (!select_reset_mode(LZWResetMode::Lru)) {
+                std::println(stderr, "Error: {}", LZWError_to_string(LZWError::ConflictingResetMode));
+                return 1;
+            }
+        }
+        else if (arg == "--bwt-block") {
+            auto kib = ParseUnsigned(argc, argv, i, 1, 256 * 1024);
+            if (!kib) {
+                std::println(stderr, "Error: {}", LZWError_to_string(LZWError::InvalidBwtBlockSize));
+                return 1;
+            }
+            bwt_block_size = static_cast<uint32_t>(*kib * 1024);
+        }
+        else if (arg == "--bwt-memory") {
+            auto mib = ParseUnsigned(argc, argv, i, 1, 64 * 1024);
+            if (!mib) {
+                std::println(stderr, "Error: {}", LZWError_to_string(LZWError::InvalidBwtMemory));
+                return 1;
+            }
+            bwt_memory = static_cast<size_t>(*mib) * 1024 * 1024;
+        }
+        else if (arg == "--bwt-chains") {
+            auto chains = ParseUnsigned(argc, argv, i, 1, 8);
+            if (!chains) {
+                std::println(stderr, "Error: {}", LZWError_to_string(LZWError::InvalidBwtChains));
+                return 1;
+            }
+            bwt_chains = static_cast<uint8_t>(*chains);
+        }
+        else if (arg == "--threads") {
+            auto count = ParseUnsigned(argc, argv, i, 0, ThreadPool::MAX_THREADS);
+            if (!count) {
+                std::println(stderr, "Error: {}", LZWError_to_string(LZWError::InvalidThreadCount));
+                return 1;
+            }
+            threads = static_cast<unsigned>(*count);
+        }
+        else if (arg == "--dict") {
+            if (i + 1 >= argc) { PrintHelp(argv[0]); return 1; }
+            dict_file = argv[++i];
+        }
+        else if (arg == "--freeze" || arg == "--clear" || arg == "--adaptive") {
+            const LZWResetMode mode = arg == "--freeze" ? LZWResetMode::Freeze :
+                arg == "--clear" ? LZWResetMode::Clear : LZWResetMode::Adaptive;
+            if (!select_reset_mode(mode)) {
+                std::println(stderr, "Error: {}", LZWError_to_string(LZWError::ConflictingResetMode));
+                return 1;
+            }
         }
-        else if (arg == "--freeze") clear_mode = false;
-        else if (arg == "--clear") clear_mode = true;
         else if (arg == "--bwt") use_bwt = true;
         else if (arg == "--mtf") use_mtf = true;
-        else if (arg[0] != '-') {
-            if (in_file.empty()) in_file = arg;
-            else if (out_file.empty()) out_file = arg;
-            else { PrintHelp(argv[0]); return 1; }
-        }
+        else if (arg == "--zero-runs") use_zero_runs = true;
+        else if (arg[0] != '-') positionals.push_back(arg);
         else { PrintHelp(argv[0]); return 1; }
     }
 
+    if (mode == "-t") {
+        if (positionals.size() < 2) {
+            std::println(stderr, "Error: {}", LZWError_to_string(LZWError::NoPathProvided));
+            PrintHelp(argv[0]);
+            return 1;
+        }
+        std::vector<std::filesystem::path> samples(positionals.begin() + 1, positionals.end());
+        auto result = LZWCoder::TrainDictionary(samples, positionals[0], max_bits_set ? max_bits : 12);
+        if (!result) {
+            std::println(stderr, "Error: {}", LZWError_to_string(result.error()));
+            return 1;
+        }
+        std::println("Dictionary '{}' trained on {} file(s): {} entries, id={:08x}",
+            positionals[0].string(), samples.size(), result->entries, result->id);
+        return 0;
+    }
+
+    if (positionals.size() > 2) { PrintHelp(argv[0]); return 1; }
+    if (positionals.size() > 0) in_file = positionals[0];
+    if (positionals.size() > 1) out_file = positionals[1];
+
     if (in_file.empty()) {
         std::println(stderr, "Error: {}", LZWError_to_string(LZWError::NoPathProvided));
         PrintHelp(argv[0]);
@@ -100,9 +197,10 @@ int main(int argc, char* argv[]) {
         }
 
         std::println("Compressing '{}' with max_bits={}, mode={}, BWT={}, MTF={}...",
-            in_file.string(), max_bits, clear_mode ? "CLEAR" : "FREEZE", use_bwt, use_mtf);
+            in_file.string(), max_bits, reset_mode == LZWResetMode::Clear ? "CLEAR" : reset_mode == LZWResetMode::Freeze ? "FREEZE" :
+            reset_mode == LZWResetMode::Adaptive ? "ADAPTIVE" : "LRU", use_bwt, use_mtf);
 
-        auto result = LZWCoder::Compress(in_file, out_file, max_bits, clear_mode, use_bwt, use_mtf);
+        auto result = LZWCoder::Compress(in_file, out_file, max_bits, reset_mode, use_bwt, use_mtf, segment_size, threads, dict_memory, dict_file, bwt_block_size, bwt_memory, bwt_chains, use_zero_runs);
 
         if (result) {
             const auto& stats = result.value();
@@ -153,7 +251,7 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        auto result = LZWCoder::Decompress(in_file, out_file);
+        auto result = LZWCoder::Decompress(in_file, out_file, threads, dict_file, bwt_memory);
         if (result) std::println("Decompression successful!");
         else {
             std::println(stderr, "Error: {}", LZWError_to_string(result.error()));